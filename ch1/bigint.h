@@ -0,0 +1,338 @@
+#ifndef BIGINT_H
+#define BIGINT_H
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Arbitrary precision unsigned integer.
+//
+// Limbs are stored little-endian in base 10^9, so printing is a linear pass
+// over the limbs and never needs a quadratic binary-to-decimal conversion.
+class BigUint {
+public:
+    using Limb = uint32_t;
+    static constexpr Limb base = 1'000'000'000;
+    static constexpr int digits_per_limb = 9;
+
+    BigUint() = default;
+    BigUint(uint64_t n) {
+        while (n) {
+            limbs_.push_back(n % base);
+            n /= base;
+        }
+    }
+
+    bool is_zero() const { return limbs_.empty(); }
+    const std::vector<Limb>& limbs() const { return limbs_; }
+
+    std::string to_string() const {
+        if (is_zero()) return "0";
+        auto s = std::to_string(limbs_.back());
+        s.reserve(limbs_.size() * digits_per_limb);
+        for (auto i = limbs_.size() - 1; i-- > 0;) {
+            char buf[digits_per_limb];
+            const auto n = std::to_chars(buf, buf + digits_per_limb, limbs_[i]).ptr - buf;
+            s.append(digits_per_limb - n, '0');
+            s.append(buf, n);
+        }
+        return s;
+    }
+
+    friend int compare(const BigUint& lhs, const BigUint& rhs) {
+        if (lhs.limbs_.size() != rhs.limbs_.size()) {
+            return lhs.limbs_.size() < rhs.limbs_.size() ? -1 : 1;
+        }
+        for (auto i = lhs.limbs_.size(); i-- > 0;) {
+            if (lhs.limbs_[i] != rhs.limbs_[i]) {
+                return lhs.limbs_[i] < rhs.limbs_[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    friend bool operator==(const BigUint& lhs, const BigUint& rhs) {
+        return lhs.limbs_ == rhs.limbs_;
+    }
+
+    friend bool operator<(const BigUint& lhs, const BigUint& rhs) {
+        return compare(lhs, rhs) < 0;
+    }
+
+    friend BigUint operator+(const BigUint& lhs, const BigUint& rhs) {
+        BigUint r;
+        r.limbs_ = add(lhs.limbs_, rhs.limbs_);
+        r.trim();
+        return r;
+    }
+
+    // Requires lhs >= rhs.
+    friend BigUint operator-(const BigUint& lhs, const BigUint& rhs) {
+        assert(compare(lhs, rhs) >= 0);
+        BigUint r = lhs;
+        sub_from(r.limbs_, rhs.limbs_);
+        r.trim();
+        return r;
+    }
+
+    friend BigUint operator*(const BigUint& lhs, const BigUint& rhs) {
+        if (lhs.is_zero() || rhs.is_zero()) return {};
+        BigUint r;
+        r.limbs_ = mul(lhs.limbs_, rhs.limbs_);
+        r.trim();
+        return r;
+    }
+
+    // Quotient and remainder (Knuth's algorithm D); requires rhs != 0.
+    friend std::pair<BigUint, BigUint> divmod(const BigUint& lhs, const BigUint& rhs) {
+        assert(!rhs.is_zero());
+        if (lhs < rhs) return {BigUint{}, lhs};
+        if (rhs.limbs_.size() == 1) {
+            BigUint q = lhs;
+            const auto r = div_small(q.limbs_, rhs.limbs_[0]);
+            q.trim();
+            return {q, BigUint{r}};
+        }
+        // Scale both operands so the divisor's top limb is at least base / 2,
+        // which keeps every estimated quotient limb within 2 of the truth.
+        const Limb d = base / (rhs.limbs_.back() + uint64_t{1});
+        auto u = mul_small(lhs.limbs_, d);
+        const auto v = mul_small(rhs.limbs_, d);
+        const auto n = rhs.limbs_.size();
+        const auto m = lhs.limbs_.size() - n;
+        if (u.size() == lhs.limbs_.size()) u.push_back(0);
+        BigUint q;
+        q.limbs_.resize(m + 1);
+        for (auto j = m + 1; j-- > 0;) {
+            const auto top = uint64_t{u[j + n]} * base + u[j + n - 1];
+            auto qhat = top / v[n - 1];
+            auto rhat = top % v[n - 1];
+            while (qhat >= base || qhat * v[n - 2] > rhat * base + u[j + n - 2]) {
+                --qhat;
+                rhat += v[n - 1];
+                if (rhat >= base) break;
+            }
+            // u[j..j+n] -= qhat * v
+            uint64_t carry = 0;
+            int64_t borrow = 0;
+            for (size_t i = 0; i < n; ++i) {
+                const auto p = qhat * v[i] + carry;
+                carry = p / base;
+                const auto t = int64_t{u[i + j]} - static_cast<int64_t>(p % base) - borrow;
+                borrow = t < 0;
+                u[i + j] = static_cast<Limb>(t < 0 ? t + base : t);
+            }
+            const auto t = int64_t{u[j + n]} - static_cast<int64_t>(carry) - borrow;
+            if (t < 0) {
+                // qhat was one too large: add v back.
+                --qhat;
+                Limb c = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    const auto s = u[i + j] + v[i] + c;
+                    c = s >= base;
+                    u[i + j] = c ? s - base : s;
+                }
+                u[j + n] = static_cast<Limb>((t + base + c) % base);
+            } else {
+                u[j + n] = static_cast<Limb>(t);
+            }
+            q.limbs_[j] = static_cast<Limb>(qhat);
+        }
+        q.trim();
+        BigUint r;
+        r.limbs_.assign(u.begin(), u.begin() + n);
+        div_small(r.limbs_, d);
+        r.trim();
+        return {q, r};
+    }
+
+    friend BigUint operator/(const BigUint& lhs, const BigUint& rhs) { return divmod(lhs, rhs).first; }
+    friend BigUint operator%(const BigUint& lhs, const BigUint& rhs) { return divmod(lhs, rhs).second; }
+
+    // lhs * base^limbs, i.e. lhs * 10^(9 limbs).
+    friend BigUint shift_limbs(const BigUint& lhs, size_t limbs) {
+        if (lhs.is_zero()) return {};
+        BigUint r;
+        r.limbs_.assign(limbs, 0);
+        r.limbs_.insert(r.limbs_.end(), lhs.limbs_.begin(), lhs.limbs_.end());
+        return r;
+    }
+
+    static BigUint pow10(size_t exponent) {
+        BigUint r = 1;
+        for (auto i = exponent % digits_per_limb; i > 0; --i) r.limbs_[0] *= 10;
+        return shift_limbs(r, exponent / digits_per_limb);
+    }
+
+    // floor(sqrt(n)) by Newton's iteration, started from a floating point
+    // estimate of the top limbs so only a handful of divisions are needed.
+    friend BigUint isqrt(const BigUint& n) {
+        if (n.limbs_.size() <= 2) {
+            const auto v = n.limbs_.empty() ? 0 : n.limbs_[0] + (n.limbs_.size() > 1 ? uint64_t{n.limbs_[1]} * base : 0);
+            auto x = static_cast<uint64_t>(std::sqrt(static_cast<double>(v)));
+            while (x * x > v) --x;
+            while ((x + 1) * (x + 1) <= v) ++x;
+            return x;
+        }
+        const auto k = (n.limbs_.size() - 2) / 2;
+        auto top = 0.0;
+        for (auto i = n.limbs_.size(); i-- > 2 * k;) top = top * base + n.limbs_[i];
+        auto x = shift_limbs(BigUint{static_cast<uint64_t>(std::sqrt(top) * (1 + 1e-9)) + 2}, k);
+        while (true) {
+            const auto y = divmod(x + n / x, 2).first;
+            if (!(y < x)) return x;
+            x = y;
+        }
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const BigUint& n) {
+        return os << n.to_string();
+    }
+
+private:
+    using Limbs = std::vector<Limb>;
+    using View = std::span<const Limb>;
+
+    // Below this many limbs schoolbook multiplication beats Karatsuba.
+    static constexpr size_t karatsuba_threshold = 32;
+
+    Limbs limbs_;
+
+    void trim() {
+        while (!limbs_.empty() && limbs_.back() == 0) limbs_.pop_back();
+    }
+
+    static View trimmed(View v) {
+        while (!v.empty() && v.back() == 0) v = v.first(v.size() - 1);
+        return v;
+    }
+
+    static Limbs mul_small(View a, Limb m) {
+        Limbs r(a.size() + 1);
+        uint64_t carry = 0;
+        for (size_t i = 0; i < a.size(); ++i) {
+            const auto cur = uint64_t{a[i]} * m + carry;
+            r[i] = cur % base;
+            carry = cur / base;
+        }
+        r.back() = static_cast<Limb>(carry);
+        if (r.back() == 0) r.pop_back();
+        return r;
+    }
+
+    // a /= m in place; returns the remainder.
+    static Limb div_small(Limbs& a, Limb m) {
+        uint64_t rem = 0;
+        for (auto i = a.size(); i-- > 0;) {
+            const auto cur = rem * base + a[i];
+            a[i] = static_cast<Limb>(cur / m);
+            rem = cur % m;
+        }
+        return static_cast<Limb>(rem);
+    }
+
+    static Limbs add(View a, View b) {
+        if (a.size() < b.size()) std::swap(a, b);
+        Limbs r(a.size() + 1);
+        Limb carry = 0;
+        for (size_t i = 0; i < a.size(); ++i) {
+            auto cur = a[i] + carry + (i < b.size() ? b[i] : 0);
+            carry = cur >= base;
+            r[i] = carry ? cur - base : cur;
+        }
+        r.back() = carry;
+        return r;
+    }
+
+    // r += v * base^offset; r must be wide enough to hold the result.
+    static void add_at(Limbs& r, size_t offset, View v) {
+        v = trimmed(v);
+        Limb carry = 0;
+        size_t i = 0;
+        for (; i < v.size(); ++i) {
+            auto cur = r[offset + i] + v[i] + carry;
+            carry = cur >= base;
+            r[offset + i] = carry ? cur - base : cur;
+        }
+        for (i += offset; carry; ++i) {
+            assert(i < r.size());
+            carry = ++r[i] == base;
+            if (carry) r[i] = 0;
+        }
+    }
+
+    // r -= v; requires r >= v.
+    static void sub_from(Limbs& r, View v) {
+        v = trimmed(v);
+        Limb borrow = 0;
+        size_t i = 0;
+        for (; i < v.size(); ++i) {
+            auto sub = v[i] + borrow;
+            borrow = r[i] < sub;
+            r[i] = borrow ? r[i] + base - sub : r[i] - sub;
+        }
+        for (; borrow; ++i) {
+            assert(i < r.size());
+            borrow = r[i] == 0;
+            r[i] = borrow ? base - 1 : r[i] - 1;
+        }
+    }
+
+    static void mul_schoolbook(View a, View b, Limb* r) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            uint64_t carry = 0;
+            const uint64_t ai = a[i];
+            if (ai == 0) continue;
+            for (size_t j = 0; j < b.size(); ++j) {
+                const auto cur = r[i + j] + ai * b[j] + carry;
+                r[i + j] = cur % base;
+                carry = cur / base;
+            }
+            for (auto k = i + b.size(); carry; ++k) {
+                const auto cur = r[k] + carry;
+                r[k] = cur % base;
+                carry = cur / base;
+            }
+        }
+    }
+
+    static Limbs mul(View a, View b) {
+        if (a.size() < b.size()) std::swap(a, b);
+        Limbs r(a.size() + b.size());
+        if (b.size() < karatsuba_threshold) {
+            mul_schoolbook(a, b, r.data());
+            return r;
+        }
+        // Unbalanced operands: multiply b by a in b-sized slices.
+        if (2 * b.size() <= a.size()) {
+            for (size_t offset = 0; offset < a.size(); offset += b.size()) {
+                const auto n = std::min(b.size(), a.size() - offset);
+                add_at(r, offset, mul(a.subspan(offset, n), b));
+            }
+            return r;
+        }
+        // Karatsuba: (a1 B + a0)(b1 B + b0) =
+        //     z2 B^2 + ((a0 + a1)(b0 + b1) - z2 - z0) B + z0
+        const auto half = a.size() / 2;
+        const auto a0 = a.first(half), a1 = a.subspan(half);
+        const auto b0 = b.first(half), b1 = b.subspan(half);
+        const auto z0 = mul(a0, b0);
+        const auto z2 = mul(a1, b1);
+        auto z1 = mul(add(a0, a1), add(b0, b1));
+        sub_from(z1, z0);
+        sub_from(z1, z2);
+        add_at(r, 0, z0);
+        add_at(r, half, z1);
+        add_at(r, 2 * half, z2);
+        return r;
+    }
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef BUFFERED_WRITER_H
+#define BUFFERED_WRITER_H
+
+#include <cerrno>
+#include <charconv>
+#include <concepts>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+// Collects formatted output in a large buffer and hands it to the file
+// descriptor in big write(2) calls, so printing millions of short lines
+// costs one system call per buffer instead of one flush per line. Call
+// flush() before the writer goes away: it throws on a failed write, while
+// the destructor's last flush cannot report one and drops it.
+class BufferedWriter {
+public:
+    explicit BufferedWriter(int fd = STDOUT_FILENO, size_t capacity = 1 << 16)
+        : fd_(fd), buffer_(capacity) {}
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+    ~BufferedWriter() {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    BufferedWriter& operator<<(char c) {
+        if (used_ == buffer_.size()) flush();
+        buffer_[used_++] = c;
+        return *this;
+    }
+
+    BufferedWriter& operator<<(std::string_view s) {
+        if (s.size() > buffer_.size() - used_) {
+            flush();
+            if (s.size() > buffer_.size()) {
+                write_all(s.data(), s.size());
+                return *this;
+            }
+        }
+        std::memcpy(buffer_.data() + used_, s.data(), s.size());
+        used_ += s.size();
+        return *this;
+    }
+
+    BufferedWriter& operator<<(const char* s) { return *this << std::string_view{s}; }
+    BufferedWriter& operator<<(const std::string& s) { return *this << std::string_view{s}; }
+
+    template <std::integral T>
+    BufferedWriter& operator<<(T n) {
+        // Enough room for any 64-bit value including the sign.
+        constexpr size_t max_digits = 21;
+        if (buffer_.size() - used_ < max_digits) flush();
+        const auto first = buffer_.data() + used_;
+        used_ = std::to_chars(first, first + max_digits, n).ptr - buffer_.data();
+        return *this;
+    }
+
+    void flush() {
+        write_all(buffer_.data(), used_);
+        used_ = 0;
+    }
+
+private:
+    int fd_;
+    std::vector<char> buffer_;
+    size_t used_ = 0;
+
+    void write_all(const char* p, size_t n) {
+        while (n > 0) {
+            const auto written = ::write(fd_, p, n);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error{std::string{"write: "} + std::strerror(errno)};
+            }
+            p += written;
+            n -= written;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+// Runtime CPU feature checks used to pick a SIMD kernel. Kernels are compiled
+// with per-function target attributes, so the binary still runs on CPUs
+// without the extension and takes the scalar path there.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+
+inline bool cpu_has_ssse3() {
+    static const bool has = __builtin_cpu_supports("ssse3");
+    return has;
+}
+
+inline bool cpu_has_avx2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#else
+#define HAVE_X86_KERNELS 0
+
+inline bool cpu_has_ssse3() { return false; }
+inline bool cpu_has_avx2() { return false; }
+#endif
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef FIB_H
+#define FIB_H
+
+#include "bigint.h"
+#include "modular.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Exact F(n) using the fast doubling identities
+//     F(2k)   = F(k) * (2 F(k+1) - F(k))
+//     F(2k+1) = F(k)^2 + F(k+1)^2
+// which take O(log n) big multiplications instead of O(n) additions.
+inline BigUint fib_big(uint64_t n) {
+    BigUint a = 0, b = 1; // F(k), F(k+1)
+    for (auto bit = std::bit_floor(n); bit; bit >>= 1) {
+        const auto c = a * (b + b - a);
+        const auto d = a * a + b * b;
+        if (n & bit) {
+            a = d;
+            b = c + d;
+        } else {
+            a = c;
+            b = d;
+        }
+    }
+    return a;
+}
+
+// Dense memo table holding F(0)..F(size() - 1) in one contiguous block.
+//
+// The table only grows through grow_to(), which extends it with a single
+// linear sweep. Once built, a const FibTable can be shared by any number of
+// threads: lookups never write.
+template <typename T = uint64_t>
+class FibTable {
+public:
+    FibTable() : table_{0, 1} {}
+    explicit FibTable(size_t n) : FibTable() { grow_to(n); }
+
+    size_t size() const { return table_.size(); }
+
+    // Makes F(n) available.
+    void grow_to(size_t n) {
+        if (n < table_.size()) return;
+        table_.reserve(n + 1);
+        for (auto i = table_.size(); i <= n; ++i) {
+            table_.push_back(table_[i - 2] + table_[i - 1]);
+        }
+    }
+
+    const T& operator[](size_t n) const { return table_[n]; }
+
+    // Answers a batch of queries, all of which must be below size().
+    // Queries are visited in increasing index order so the table is read
+    // front to back regardless of how the batch was ordered.
+    template <typename Index>
+    std::vector<T> lookup(std::span<const Index> queries) const {
+        std::vector<size_t> order(queries.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(),
+                [&queries](size_t lhs, size_t rhs) { return queries[lhs] < queries[rhs]; });
+        std::vector<T> ans(queries.size());
+        for (const auto i : order) ans[i] = table_[queries[i]];
+        return ans;
+    }
+
+private:
+    std::vector<T> table_;
+};
+
+// Answers every query from one table built up to the largest index.
+// With the default uint64_t values, results wrap modulo 2^64 past F(93).
+template <typename T = uint64_t, typename Index>
+std::vector<T> fib_batch(std::span<const Index> queries) {
+    if (queries.empty()) return {};
+    FibTable<T> table{static_cast<size_t>(*std::max_element(queries.begin(), queries.end()))};
+    return table.lookup(queries);
+}
+
+// Writes the sequence seeded by (a, b) = (F(0), F(1)) into out, wrapping
+// modulo 2^64. Each step emits four terms computed straight from the pair
+// that starts it, e.g. F(i+3) = F(i) + 2F(i+1), so the loop-carried
+// dependency is one step per four terms instead of one add per term.
+// Passing the two terms after the last one written, F(n) and F(n+1),
+// continues the sequence.
+inline void fill_fib(std::span<uint64_t> out, uint64_t a = 0, uint64_t b = 1) {
+    size_t i = 0;
+    for (; i + 4 <= out.size(); i += 4) {
+        out[i] = a;
+        out[i + 1] = b;
+        out[i + 2] = a + b;
+        out[i + 3] = a + 2 * b;
+        const auto next_a = 2 * a + 3 * b;
+        const auto next_b = 3 * a + 5 * b;
+        a = next_a;
+        b = next_b;
+    }
+    for (; i < out.size(); ++i) {
+        out[i] = a;
+        a = std::exchange(b, a + b);
+    }
+}
+
+// Same as fill_fib() with every term reduced modulo m; a and b are reduced
+// first. While 8m fits in 64 bits each term is one independent
+// division, otherwise terms are chained through addmod().
+inline void fill_fib_mod(std::span<uint64_t> out, uint64_t m, uint64_t a = 0, uint64_t b = 1) {
+    assert(m > 0);
+    a %= m;
+    b %= m;
+    size_t i = 0;
+    if (m <= UINT64_MAX / 8) {
+        for (; i + 4 <= out.size(); i += 4) {
+            out[i] = a;
+            out[i + 1] = b;
+            out[i + 2] = (a + b) % m;
+            out[i + 3] = (a + 2 * b) % m;
+            const auto next_a = (2 * a + 3 * b) % m;
+            const auto next_b = (3 * a + 5 * b) % m;
+            a = next_a;
+            b = next_b;
+        }
+    }
+    for (; i < out.size(); ++i) {
+        out[i] = a;
+        a = std::exchange(b, addmod(a, b, m));
+    }
+}
+
+// 2x2 matrix of residues modulo some m.
+struct FibMatrix { uint64_t a, b, c, d; };
+
+inline FibMatrix multiply(const FibMatrix& x, const FibMatrix& y, uint64_t m) {
+    return {
+        addmod(mulmod(x.a, y.a, m), mulmod(x.b, y.c, m), m),
+        addmod(mulmod(x.a, y.b, m), mulmod(x.b, y.d, m), m),
+        addmod(mulmod(x.c, y.a, m), mulmod(x.d, y.c, m), m),
+        addmod(mulmod(x.c, y.b, m), mulmod(x.d, y.d, m), m),
+    };
+}
+
+// [[1, 1], [1, 0]]^e = [[F(e+1), F(e)], [F(e), F(e-1)]] modulo m.
+inline FibMatrix fib_matrix_pow(uint128_t e, uint64_t m) {
+    FibMatrix r{1 % m, 0, 0, 1 % m};
+    FibMatrix q{1 % m, 1 % m, 1 % m, 0};
+    for (; e; e >>= 1) {
+        if (e & 1) r = multiply(r, q, m);
+        q = multiply(q, q, m);
+    }
+    return r;
+}
+
+inline bool is_fib_identity(uint128_t e, uint64_t m) {
+    const auto r = fib_matrix_pow(e, m);
+    return r.a == 1 % m && r.b == 0 && r.c == 0 && r.d == 1 % m;
+}
+
+// Pisano period pi(m): the period of F(n) mod m. It can exceed 2^64 for
+// moduli close to 2^64, hence the 128-bit result.
+//
+// pi(m) is the lcm of pi(p^k) over the prime powers of m. pi(p) divides
+// p - 1 when p = +-1 (mod 5) and 2(p + 1) when p = +-2 (mod 5), and
+// pi(p^k) divides p^(k-1) pi(p), so each factor is found by dividing a
+// known multiple down to the order of the Fibonacci matrix.
+inline uint128_t pisano_period(uint64_t m) {
+    assert(m > 0);
+    uint128_t period = 1;
+    for (const auto& [p, k] : factorize(m)) {
+        uint128_t d;
+        std::vector<std::pair<uint64_t, unsigned>> d_factors;
+        if (p == 2) {
+            d = 3;
+            d_factors = {{3, 1}};
+        } else if (p == 5) {
+            d = 20;
+            d_factors = {{2, 2}, {5, 1}};
+        } else if (p % 5 == 1 || p % 5 == 4) {
+            d = p - 1;
+            d_factors = factorize(p - 1);
+        } else {
+            d = static_cast<uint128_t>(p + 1) * 2;
+            d_factors = factorize(p + 1);
+            if (d_factors.empty() || d_factors.front().first != 2) {
+                d_factors.insert(d_factors.begin(), {2, 0});
+            }
+            ++d_factors.front().second;
+        }
+        for (const auto& [q, _] : d_factors) {
+            while (d % q == 0 && is_fib_identity(d / q, p)) d /= q;
+        }
+        uint64_t pk = p;
+        for (unsigned i = 1; i < k; ++i) {
+            pk *= p;
+            d *= p;
+        }
+        while (k > 1 && d % p == 0 && is_fib_identity(d / p, pk)) d /= p;
+        period = period / gcd128(period, d) * d;
+    }
+    return period;
+}
+
+inline uint64_t fib_mod_uncached(uint128_t n, uint64_t m) {
+    assert(m > 0);
+    return fib_matrix_pow(n, m).b;
+}
+
+// F(n) mod m with the Pisano period of every modulus seen so far cached,
+// so repeated queries against the same m only pay for a reduced exponent.
+// Safe to share between threads.
+class PisanoCache {
+public:
+    uint128_t period(uint64_t m) {
+        {
+            std::lock_guard lock{mutex_};
+            const auto it = periods_.find(m);
+            if (it != periods_.end()) return it->second;
+        }
+        const auto p = pisano_period(m);
+        std::lock_guard lock{mutex_};
+        periods_.emplace(m, p);
+        return p;
+    }
+
+    uint64_t fib_mod(uint64_t n, uint64_t m) {
+        return fib_mod_uncached(n % period(m), m);
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, uint128_t> periods_;
+};
+
+inline uint64_t fib_mod(uint64_t n, uint64_t m) {
+    static PisanoCache cache;
+    return cache.fib_mod(n, m);
+}
+
+#endif
@@ -1,5 +1,7 @@
+#include "fib.h"
 #include <iostream>
 #include <string>
+#include <unistd.h>
 
 unsigned fib(unsigned n) {
     return n < 2
@@ -8,7 +10,16 @@ unsigned fib(unsigned n) {
 }
 
 int main(int argc, char* argv[]) {
-    for (int i = 1; i < argc; i++) {
-        std::cout << fib(std::stoi(argv[i])) << '\n';
+    bool exact = false;
+    int c;
+    while ((c = getopt(argc, argv, "b")) != -1) {
+        switch (c) {
+            case 'b': exact = true; break;
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        const auto n = std::stoul(argv[i]);
+        if (exact) std::cout << fib_big(n) << '\n';
+        else std::cout << fib(n) << '\n';
     }
 }
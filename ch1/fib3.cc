@@ -1,6 +1,9 @@
+#include "fib.h"
 #include <iostream>
 #include <unordered_map>
 #include <string>
+#include <unistd.h>
+#include <vector>
 
 unsigned fib(unsigned n) {
     static std::unordered_map<unsigned, unsigned> memo{{0, 0}, {1, 1}};
@@ -14,7 +17,24 @@ unsigned fib(unsigned n) {
 }
 
 int main(int argc, char* argv[]) {
-    for (int i = 1; i < argc; i++) {
-        std::cout << fib(std::stoi(argv[i])) << '\n';
+    bool exact = false;
+    bool batch = false;
+    int c;
+    while ((c = getopt(argc, argv, "bB")) != -1) {
+        switch (c) {
+            case 'b': exact = true; break;
+            case 'B': batch = true; break;
+        }
+    }
+    if (batch && !exact) {
+        std::vector<unsigned long> queries;
+        for (int i = optind; i < argc; i++) queries.push_back(std::stoul(argv[i]));
+        for (const auto f : fib_batch(std::span<const unsigned long>{queries})) std::cout << f << '\n';
+        return 0;
+    }
+    for (int i = optind; i < argc; i++) {
+        const auto n = std::stoul(argv[i]);
+        if (exact) std::cout << fib_big(n) << '\n';
+        else std::cout << fib(n) << '\n';
     }
 }
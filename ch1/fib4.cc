@@ -15,8 +15,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "fib.h"
 #include <iostream>
 #include <string>
+#include <unistd.h>
 
 unsigned fib(unsigned n) {
     unsigned last = 0, next = 1;
@@ -29,7 +31,19 @@ unsigned fib(unsigned n) {
 };
 
 int main(int argc, char* argv[]) {
-    for (int i = 1; i < argc; i++) {
-        std::cout << fib(std::stoi(argv[i])) << std::endl;
+    bool exact = false;
+    uint64_t modulus = 0;
+    int c;
+    while ((c = getopt(argc, argv, "bm:")) != -1) {
+        switch (c) {
+            case 'b': exact = true; break;
+            case 'm': modulus = std::stoull(optarg); break;
+        }
     }
-}
\ No newline at end of file
+    for (int i = optind; i < argc; i++) {
+        const auto n = std::stoull(argv[i]);
+        if (modulus) std::cout << fib_mod(n, modulus) << '\n';
+        else if (exact) std::cout << fib_big(n) << '\n';
+        else std::cout << fib(n) << std::endl;
+    }
+}
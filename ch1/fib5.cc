@@ -15,18 +15,25 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "buffered_writer.h"
+#include "fib.h"
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <ranges>
 #include <string>
+#include <unistd.h>
 
-class Fib: public std::iterator<std::input_iterator_tag, unsigned, unsigned, const unsigned*, unsigned> {
+class Fib {
     private:
-        unsigned last = 0, next = 1;
+        uint64_t last = 0, next = 1;
     public:
+        using value_type = uint64_t;
+        using difference_type = std::ptrdiff_t;
         Fib() {};
         Fib& operator++() {
-            unsigned oldLast = last;
-            last = next;
-            next = oldLast + last;
+            last = std::exchange(next, last + next);
             return *this;
         };
         Fib operator++(int) {
@@ -34,17 +41,63 @@ class Fib: public std::iterator<std::input_iterator_tag, unsigned, unsigned, con
             ++(*this);
             return result;
         };
-        reference operator*() const { return last; };
-        bool operator==(const Fib& other) const { return (last == other.last) && (next == other.next); };
-        bool operator!=(const Fib& other) const { return !(*this == other); };
-
+        value_type operator*() const { return last; };
+        bool operator==(const Fib& other) const = default;
 };
 
+static_assert(std::forward_iterator<Fib>);
+
+// The endless Fibonacci sequence as a view, e.g. fib_sequence() | std::views::take(n).
+inline auto fib_sequence() {
+    return std::ranges::subrange{Fib{}, std::unreachable_sentinel};
+}
 
 int main(int argc, char* argv[]) {
-    Fib generator;
-    
-    for(int i = 0; i < 40; i++) {
-        std::cout << i << ": " << *generator++ << std::endl;
+    bool use_generator = false;
+    uint64_t modulus = 0;
+    int c;
+    while ((c = getopt(argc, argv, "gm:")) != -1) {
+        switch (c) {
+            case 'g': use_generator = true; break;
+            case 'm': modulus = std::stoull(optarg); break;
+        }
+    }
+    const uint64_t count = optind < argc ? std::stoull(argv[optind]) : 40;
+    try {
+        BufferedWriter out;
+        if (use_generator) {
+            uint64_t i = 0;
+            for (const auto f : fib_sequence() | std::views::take(count)) {
+                out << i++ << ": " << f << '\n';
+            }
+            out.flush();
+            return 0;
+        }
+
+        // Bulk path: fill a block of terms at a time, seeding each block with
+        // the two terms that follow the previous one.
+        std::array<uint64_t, 4096> block;
+        uint64_t a = 0, b = modulus ? 1 % modulus : 1;
+        for (uint64_t first = 0; first < count; first += block.size()) {
+            const auto n = std::min<uint64_t>(block.size(), count - first);
+            auto terms = std::span{block}.first(n);
+            if (modulus) fill_fib_mod(terms, modulus, a, b);
+            else fill_fib(terms, a, b);
+            for (uint64_t i = 0; i < n; i++) {
+                out << first + i << ": " << terms[i] << '\n';
+            }
+            if (n < 2) break;
+            if (modulus) {
+                a = addmod(terms[n - 2], terms[n - 1], modulus);
+                b = addmod(terms[n - 1], a, modulus);
+            } else {
+                a = terms[n - 2] + terms[n - 1];
+                b = terms[n - 1] + a;
+            }
+        }
+        out.flush();
+    } catch (const std::exception& e) {
+        std::cerr << argv[0] << ": " << e.what() << '\n';
+        return 1;
     }
-}
\ No newline at end of file
+}
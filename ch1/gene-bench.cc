@@ -0,0 +1,88 @@
+// gene-bench.cc
+//
+// Times GC content, Hamming distance and reverse complement computed on the
+// packed words (gene_stats.h) against the string path: decompressing the
+// std::vector<bool> from gene.h into a std::string and working on chars.
+//
+//     gene-bench [bases] [seed]
+
+#include "gene.h"
+#include "gene_stats.h"
+#include "packed_gene.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Best of a few runs, in milliseconds.
+template <typename F>
+double time_ms(F f) {
+    auto best = 1e300;
+    for (int run = 0; run < 3; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void report(const char* name, double string_ms, double packed_ms, bool same) {
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << string_ms << std::setw(12) << packed_ms
+              << std::setw(10) << std::setprecision(1) << string_ms / packed_ms << 'x'
+              << (same ? "" : "  MISMATCH") << '\n';
+}
+
+std::string random_gene(size_t n, std::mt19937_64& rng) {
+    std::string s(n, ' ');
+    for (auto& c : s) c = "ACGT"[rng() & 3];
+    return s;
+}
+
+int main(int argc, char* argv[]) {
+    const size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t{1} << 22;
+    std::mt19937_64 rng{argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1};
+    const auto a = random_gene(n, rng);
+    auto b = a;
+    for (size_t i = 0; i < n; i += 7) b[i] = "ACGT"[rng() & 3];
+
+    const auto bits_a = compress(a), bits_b = compress(b);
+    const PackedGene packed_a{a}, packed_b{b};
+
+    std::cout << "bases: " << n << '\n'
+              << std::left << std::setw(20) << "operation" << std::right
+              << std::setw(12) << "string ms" << std::setw(12) << "packed ms" << std::setw(11) << "speedup" << '\n';
+
+    uint64_t gc_string = 0, gc_packed = 0;
+    const auto gc_string_ms = time_ms([&]() {
+            const auto s = decompress(bits_a);
+            gc_string = std::count_if(s.begin(), s.end(), [](char c) { return c == 'C' || c == 'G'; });
+            });
+    const auto gc_packed_ms = time_ms([&]() { gc_packed = gc_count(packed_a); });
+    report("gc content", gc_string_ms, gc_packed_ms, gc_string == gc_packed);
+
+    uint64_t hd_string = 0, hd_packed = 0;
+    const auto hd_string_ms = time_ms([&]() {
+            const auto s = decompress(bits_a), t = decompress(bits_b);
+            hd_string = 0;
+            for (size_t i = 0; i < n; ++i) hd_string += s[i] != t[i];
+            });
+    const auto hd_packed_ms = time_ms([&]() { hd_packed = hamming_distance(packed_a, packed_b); });
+    report("hamming distance", hd_string_ms, hd_packed_ms, hd_string == hd_packed);
+
+    std::string rc_string;
+    PackedGene rc_packed;
+    const auto rc_string_ms = time_ms([&]() {
+            const auto s = decompress(bits_a);
+            rc_string.assign(s.rbegin(), s.rend());
+            for (auto& c : rc_string) c = complement(c);
+            });
+    const auto rc_packed_ms = time_ms([&]() { rc_packed = reverse_complement(packed_a); });
+    report("reverse complement", rc_string_ms, rc_packed_ms, rc_string == rc_packed.decompress());
+}
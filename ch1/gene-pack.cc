@@ -0,0 +1,448 @@
+// gene-pack.cc
+//
+// Packs FASTA or plain sequence files into a chunked 2-bit archive and reads
+// them back, either whole or one region at a time.
+//
+//     gene-pack [-j threads] [-b bases-per-chunk] -c input archive
+//     gene-pack -x archive                 (FASTA to stdout)
+//     gene-pack -r start:count archive     (raw bases to stdout)
+//     gene-pack -k k [-n top] archive      (most frequent k-mers)
+//     gene-pack -s pattern [-e max] archive (matches with <= max mismatches)
+//
+// Queries run on the packed chunks and report archive-wide base offsets;
+// a k-mer or match never spans two records.
+
+#include "buffered_writer.h"
+#include "gene_search.h"
+#include "mapped_file.h"
+#include "packed_gene.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Archive layout, all integers are host-endian uint64:
+//     header  ArchiveHeader, rewritten once the index offset is known
+//     chunks  PackedGene::serialize() images, one per chunk, in order
+//     index   (offset, length) per chunk, then per record its first base,
+//             name length and name, padded to 8 bytes
+constexpr char archive_magic[8] = {'G', 'E', 'N', 'E', 'P', 'A', 'C', 'K'};
+constexpr uint64_t archive_version = 2;
+
+struct ArchiveHeader {
+    char magic[8];
+    uint64_t version;
+    uint64_t total_bases;
+    uint64_t chunk_bases;
+    uint64_t chunk_count;
+    uint64_t line_width;
+    uint64_t record_count;
+    uint64_t index_offset;
+};
+
+// A FASTA record: its '>' line without the '>' and where its bases start.
+struct Record {
+    uint64_t first_base;
+    std::string name;
+};
+
+// One input line; [begin, end) excludes the line terminator.
+struct Line {
+    const char* begin;
+    const char* end;
+    const char* next;
+};
+
+Line line_at(const char* p, const char* end) {
+    const auto nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    auto content_end = nl ? nl : end;
+    if (content_end > p && content_end[-1] == '\r') --content_end;
+    return {p, content_end, nl ? nl + 1 : end};
+}
+
+// Result of the sequential pre-pass: records, and the file offset of the
+// first base of every chunk so chunks can be packed independently.
+struct Layout {
+    uint64_t total_bases = 0;
+    uint64_t line_width = 0;
+    std::vector<uint64_t> chunk_offsets;
+    std::vector<Record> records;
+};
+
+Layout scan(const char* data, size_t size, uint64_t chunk_bases) {
+    Layout layout;
+    const auto end = data + size;
+    for (auto p = data; p < end;) {
+        const auto line = line_at(p, end);
+        if (*p == '>') {
+            layout.records.push_back({layout.total_bases, std::string(p + 1, line.end)});
+        } else if (line.end > line.begin) {
+            const uint64_t n = line.end - line.begin;
+            if (!layout.line_width) layout.line_width = n;
+            const auto first = layout.total_bases;
+            for (auto b = (first + chunk_bases - 1) / chunk_bases * chunk_bases; b < first + n; b += chunk_bases) {
+                layout.chunk_offsets.push_back(line.begin - data + (b - first));
+            }
+            layout.total_bases += n;
+        }
+        p = line.next;
+    }
+    return layout;
+}
+
+// Copies count bases starting at file offset into out, skipping line
+// terminators and '>' lines.
+void gather(const char* data, size_t size, uint64_t offset, uint64_t count, std::string& out) {
+    out.clear();
+    const auto end = data + size;
+    auto p = data + offset;
+    auto line_start = offset == 0 || p[-1] == '\n';
+    while (out.size() < count) {
+        if (p == end) throw std::runtime_error{"input changed while packing"};
+        const auto line = line_at(p, end);
+        if (!line_start || *p != '>') {
+            out.append(p, std::min<uint64_t>(line.end - p, count - out.size()));
+        }
+        p = line.next;
+        line_start = true;
+    }
+}
+
+void put_u64(BufferedWriter& out, uint64_t n) {
+    out << std::string_view{reinterpret_cast<const char*>(&n), sizeof(n)};
+}
+
+void compress(const std::string& input, const std::string& output, uint64_t chunk_bases, unsigned threads) {
+    MappedFile in{input};
+    in.advise(MADV_SEQUENTIAL);
+    const auto layout = scan(in.data(), in.size(), chunk_bases);
+    const auto chunk_count = layout.chunk_offsets.size();
+
+    // Written next to output and renamed over it once complete, so a failed
+    // run never leaves a truncated archive behind. Renaming would replace a
+    // device or pipe, and the header is rewritten in place, so only regular
+    // files will do.
+    struct stat st;
+    if (::stat(output.c_str(), &st) == 0 && !S_ISREG(st.st_mode)) {
+        throw std::runtime_error{output + ": not a regular file"};
+    }
+    const auto temp = output + ".tmp";
+    const auto fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw os_error("open " + temp);
+    try {
+        ArchiveHeader header{
+            {}, archive_version, layout.total_bases, chunk_bases, chunk_count,
+            layout.line_width, layout.records.size(), 0,
+        };
+        std::memcpy(header.magic, archive_magic, sizeof(archive_magic));
+        std::vector<uint64_t> index;
+        index.reserve(2 * chunk_count);
+        BufferedWriter out{fd, 1 << 20};
+        out << std::string_view{reinterpret_cast<const char*>(&header), sizeof(header)};
+        uint64_t offset = sizeof(header);
+        // Chunks are packed in parallel a batch at a time and written in
+        // order, so memory stays bounded by the batch, not the input.
+        const size_t batch = 4 * threads;
+        std::vector<std::vector<char>> images(batch);
+        for (size_t first = 0; first < chunk_count; first += batch) {
+            const auto n = std::min(batch, chunk_count - first);
+            std::atomic<size_t> next{0};
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            auto work = [&]() {
+                try {
+                    std::string bases;
+                    for (size_t i; (i = next++) < n;) {
+                        const auto chunk = first + i;
+                        const auto count = std::min(chunk_bases, layout.total_bases - chunk * chunk_bases);
+                        gather(in.data(), in.size(), layout.chunk_offsets[chunk], count, bases);
+                        images[i].clear();
+                        PackedGene{bases}.serialize(images[i]);
+                    }
+                } catch (...) {
+                    const std::lock_guard lock{error_mutex};
+                    if (!error) error = std::current_exception();
+                    next = n;
+                }
+            };
+            std::vector<std::thread> pool;
+            for (unsigned t = 1; t < std::min<size_t>(threads, n); ++t) pool.emplace_back(work);
+            work();
+            for (auto& t : pool) t.join();
+            if (error) std::rethrow_exception(error);
+            for (size_t i = 0; i < n; ++i) {
+                out << std::string_view{images[i].data(), images[i].size()};
+                index.push_back(offset);
+                index.push_back(images[i].size());
+                offset += images[i].size();
+            }
+        }
+        header.index_offset = offset;
+        for (const auto n : index) put_u64(out, n);
+        for (const auto& r : layout.records) {
+            put_u64(out, r.first_base);
+            put_u64(out, r.name.size());
+            out << r.name << std::string((8 - r.name.size() % 8) % 8, '\0');
+        }
+        out.flush();
+        if (::pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) throw os_error("write " + temp);
+    } catch (...) {
+        ::close(fd);
+        ::unlink(temp.c_str());
+        throw;
+    }
+    if (::close(fd) < 0) {
+        const auto e = os_error("write " + temp);
+        ::unlink(temp.c_str());
+        throw e;
+    }
+    if (std::rename(temp.c_str(), output.c_str()) < 0) {
+        const auto e = os_error("rename " + temp);
+        ::unlink(temp.c_str());
+        throw e;
+    }
+}
+
+class Archive {
+public:
+    explicit Archive(const std::string& path) : file_{path} {
+        if (file_.size() < sizeof(header_)) throw std::runtime_error{path + ": not a gene archive"};
+        std::memcpy(&header_, file_.data(), sizeof(header_));
+        if (std::memcmp(header_.magic, archive_magic, sizeof(archive_magic)) != 0
+                || header_.version != archive_version) {
+            throw std::runtime_error{path + ": not a gene archive"};
+        }
+        const auto chunks = header_.chunk_bases ? header_.total_bases / header_.chunk_bases
+                + (header_.total_bases % header_.chunk_bases != 0) : 0;
+        if (header_.chunk_bases == 0 || header_.chunk_count != chunks) {
+            throw std::runtime_error{path + ": corrupt header"};
+        }
+        auto p = header_.index_offset;
+        if (p > file_.size() || header_.chunk_count > (file_.size() - p) / 16) {
+            throw std::runtime_error{path + ": truncated index"};
+        }
+        auto next_u64 = [this, &p, &path]() {
+            uint64_t n;
+            if (p + sizeof(n) > file_.size()) throw std::runtime_error{path + ": truncated index"};
+            std::memcpy(&n, file_.data() + p, sizeof(n));
+            p += sizeof(n);
+            return n;
+        };
+        index_.resize(2 * header_.chunk_count);
+        for (auto& n : index_) n = next_u64();
+        for (uint64_t i = 0; i < header_.record_count; ++i) {
+            Record r;
+            r.first_base = next_u64();
+            const auto len = next_u64();
+            if (len > file_.size() - p) throw std::runtime_error{path + ": truncated index"};
+            r.name.assign(file_.data() + p, len);
+            p += (len + 7) / 8 * 8;
+            records_.push_back(std::move(r));
+        }
+    }
+
+    uint64_t size() const { return header_.total_bases; }
+    uint64_t line_width() const { return header_.line_width; }
+    size_t chunk_count() const { return header_.chunk_count; }
+    uint64_t chunk_bases() const { return header_.chunk_bases; }
+    const std::vector<Record>& records() const { return records_; }
+
+    PackedGene chunk(size_t i) const {
+        if (i >= chunk_count()) throw std::runtime_error{"chunk outside archive"};
+        const auto offset = index_[2 * i], length = index_[2 * i + 1];
+        if (offset > file_.size() || length > file_.size() - offset) {
+            throw std::runtime_error{"chunk outside archive"};
+        }
+        return PackedGene::deserialize(file_.data() + offset, length);
+    }
+
+    // Writes bases [pos, pos + count) to out, unpacking only the chunks
+    // that overlap the region.
+    void read(uint64_t pos, uint64_t count, char* out) const {
+        if (pos > size() || count > size() - pos) throw std::runtime_error{"region outside archive"};
+        while (count) {
+            const auto k = pos / chunk_bases();
+            const auto g = chunk(k);
+            const auto local = pos - k * chunk_bases();
+            const auto n = std::min<uint64_t>(count, g.size() - local);
+            g.decompress(local, n, out);
+            out += n;
+            pos += n;
+            count -= n;
+        }
+    }
+
+private:
+    MappedFile file_;
+    ArchiveHeader header_;
+    std::vector<uint64_t> index_;
+    std::vector<Record> records_;
+};
+
+// Writes the archive back as FASTA, wrapping lines at the input's width.
+void write_fasta(const Archive& archive, BufferedWriter& out) {
+    const auto& records = archive.records();
+    const auto width = std::max<uint64_t>(archive.line_width(), 1);
+    size_t next_record = 0;
+    uint64_t column = 0;
+    auto start_records = [&](uint64_t pos) {
+        for (; next_record < records.size() && records[next_record].first_base == pos; ++next_record) {
+            if (column) out << '\n';
+            column = 0;
+            out << '>' << records[next_record].name << '\n';
+        }
+    };
+    for (size_t k = 0; k < archive.chunk_count(); ++k) {
+        const auto bases = archive.chunk(k).decompress();
+        const auto base0 = k * archive.chunk_bases();
+        for (size_t i = 0; i < bases.size();) {
+            start_records(base0 + i);
+            auto n = std::min<uint64_t>(bases.size() - i, width - column);
+            if (next_record < records.size()) n = std::min(n, records[next_record].first_base - (base0 + i));
+            out << std::string_view{bases.data() + i, n};
+            i += n;
+            column += n;
+            if (column == width) {
+                out << '\n';
+                column = 0;
+            }
+        }
+    }
+    start_records(archive.size());
+    if (column) out << '\n';
+}
+
+// Calls f(first_base, chunk, own) for every chunk with the first `overlap`
+// bases of the next chunk appended, so windows that straddle a boundary are
+// seen; only windows starting before `own` belong to the chunk. The overlap
+// is shifted in as packed words, never unpacked.
+template <typename F>
+void for_each_chunk(const Archive& archive, uint64_t overlap, F f) {
+    if (archive.chunk_count() == 0) return;
+    if (overlap > archive.chunk_bases()) throw std::runtime_error{"query longer than a chunk"};
+    auto next = archive.chunk(0);
+    for (size_t k = 0; k < archive.chunk_count(); ++k) {
+        auto current = std::move(next);
+        const auto own = current.size();
+        if (k + 1 < archive.chunk_count()) {
+            next = archive.chunk(k + 1);
+            current.append(next.prefix(std::min<uint64_t>(overlap, next.size())));
+        }
+        f(k * archive.chunk_bases(), current, own);
+    }
+}
+
+// Tells whether a window of `length` bases lies within one record. Windows
+// must be asked about in increasing order of their first base.
+class RecordWindows {
+public:
+    RecordWindows(const std::vector<Record>& records, uint64_t length) : records_(records), length_(length) {}
+
+    bool within_record(uint64_t first) {
+        while (next_ < records_.size() && records_[next_].first_base <= first) ++next_;
+        return next_ == records_.size() || records_[next_].first_base >= first + length_;
+    }
+
+private:
+    const std::vector<Record>& records_;
+    uint64_t length_;
+    size_t next_ = 0;
+};
+
+void print_top_kmers(const Archive& archive, unsigned k, size_t top) {
+    if (k == 0 || k > 32) throw std::runtime_error{"k must be between 1 and 32"};
+    KmerCounter counter;
+    RecordWindows windows{archive.records(), k};
+    for_each_chunk(archive, k - 1, [&](uint64_t first, const PackedGene& g, size_t own) {
+            for_each_kmer(g, k, [&](size_t pos, uint64_t kmer) {
+                    if (pos < own && windows.within_record(first + pos)) counter.add(kmer);
+                    });
+            });
+    BufferedWriter out;
+    for (const auto& [kmer, n] : counter.top(top)) out << kmer_to_string(kmer, k) << '\t' << n << '\n';
+    out.flush();
+}
+
+void print_matches(const Archive& archive, const std::string& pattern, unsigned max_mismatches) {
+    BufferedWriter out;
+    RecordWindows windows{archive.records(), pattern.size()};
+    for_each_chunk(archive, pattern.size() - 1, [&](uint64_t first, const PackedGene& g, size_t own) {
+            search(g, pattern, max_mismatches, [&](size_t pos, unsigned mismatches) {
+                    if (pos < own && windows.within_record(first + pos)) out << first + pos << '\t' << mismatches << '\n';
+                    });
+            });
+    out.flush();
+}
+
+int main(int argc, char* argv[]) {
+    enum class Mode { None, Compress, Extract, Region, Kmers, Search } mode = Mode::None;
+    uint64_t chunk_bases = 1 << 24;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string region, pattern;
+    unsigned k = 0, max_mismatches = 0;
+    size_t top = 10;
+    int c;
+    while ((c = getopt(argc, argv, "b:ce:j:k:n:r:s:x")) != -1) {
+        switch (c) {
+            case 'b': chunk_bases = std::stoull(optarg); break;
+            case 'c': mode = Mode::Compress; break;
+            case 'e': max_mismatches = std::stoul(optarg); break;
+            case 'j': threads = std::max(1, std::stoi(optarg)); break;
+            case 'k': mode = Mode::Kmers; k = std::stoul(optarg); break;
+            case 'n': top = std::stoull(optarg); break;
+            case 'r': mode = Mode::Region; region = optarg; break;
+            case 's': mode = Mode::Search; pattern = optarg; break;
+            case 'x': mode = Mode::Extract; break;
+        }
+    }
+    const auto args = argc - optind;
+    try {
+        if (mode == Mode::Compress && args == 2) {
+            // Whole words per chunk keep every chunk boundary word aligned.
+            chunk_bases = std::max<uint64_t>(chunk_bases / PackedGene::bases_per_word, 1) * PackedGene::bases_per_word;
+            compress(argv[optind], argv[optind + 1], chunk_bases, threads);
+        } else if (mode == Mode::Extract && args == 1) {
+            Archive archive{argv[optind]};
+            BufferedWriter out{STDOUT_FILENO, 1 << 20};
+            write_fasta(archive, out);
+            out.flush();
+        } else if (mode == Mode::Region && args == 1) {
+            const auto colon = region.find(':');
+            if (colon == std::string::npos) throw std::runtime_error{"region must be start:count"};
+            const auto start = std::stoull(region.substr(0, colon));
+            const auto count = std::stoull(region.substr(colon + 1));
+            Archive archive{argv[optind]};
+            std::string bases(count, ' ');
+            archive.read(start, count, bases.data());
+            BufferedWriter out;
+            out << bases << '\n';
+            out.flush();
+        } else if (mode == Mode::Kmers && args == 1) {
+            print_top_kmers(Archive{argv[optind]}, k, top);
+        } else if (mode == Mode::Search && args == 1 && !pattern.empty()) {
+            print_matches(Archive{argv[optind]}, pattern, max_mismatches);
+        } else {
+            std::cerr << "usage: " << argv[0] << " [-j threads] [-b bases] -c input archive\n"
+                      << "       " << argv[0] << " -x archive\n"
+                      << "       " << argv[0] << " -r start:count archive\n"
+                      << "       " << argv[0] << " -k k [-n top] archive\n"
+                      << "       " << argv[0] << " -s pattern [-e max-mismatches] archive\n";
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << argv[0] << ": " << e.what() << '\n';
+        return 1;
+    }
+}
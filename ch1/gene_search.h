@@ -0,0 +1,224 @@
+#ifndef GENE_SEARCH_H
+#define GENE_SEARCH_H
+
+#include "packed_gene.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Queries that run on the 2-bit words of a PackedGene, without unpacking it.
+//
+// A k-mer (k <= 32) is kept the way PackedGene keeps bases: its first base
+// in the two lowest bits.
+
+// The 32 bases starting at pos as one word; bases past the end read as A.
+inline uint64_t packed_window(const PackedGene& g, size_t pos) {
+    const auto& words = g.words();
+    const auto w = pos / PackedGene::bases_per_word;
+    const auto shift = 2 * (pos % PackedGene::bases_per_word);
+    auto window = words[w] >> shift;
+    if (shift && w + 1 < words.size()) window |= words[w + 1] << (64 - shift);
+    return window;
+}
+
+// Same as packed_window() for the ambiguity mask: bit i set if base pos + i
+// was not ACGT.
+inline uint32_t ambiguity_window(const PackedGene& g, size_t pos) {
+    const auto& mask = g.ambiguity_mask();
+    if (mask.empty()) return 0;
+    const auto w = pos / 64;
+    const auto shift = pos % 64;
+    auto window = mask[w] >> shift;
+    if (shift && w + 1 < mask.size()) window |= mask[w + 1] << (64 - shift);
+    return static_cast<uint32_t>(window);
+}
+
+inline uint64_t kmer_mask(unsigned k) {
+    assert(0 < k && k <= 32);
+    return k == 32 ? ~uint64_t{0} : (uint64_t{1} << (2 * k)) - 1;
+}
+
+inline std::string kmer_to_string(uint64_t kmer, unsigned k) {
+    std::string s(k, ' ');
+    for (unsigned i = 0; i < k; ++i) s[i] = "ACGT"[(kmer >> (2 * i)) & 3];
+    return s;
+}
+
+// Calls f(pos, kmer) for every k-mer of g that has no ambiguous base.
+// Each k-mer is cut straight out of a two-word window, so there is no
+// per-base shift-in loop carried from one position to the next.
+template <typename F>
+void for_each_kmer(const PackedGene& g, unsigned k, F f) {
+    if (g.size() < k) return;
+    const auto mask = kmer_mask(k);
+    const auto last = g.size() - k;
+    const auto has_ambiguity = !g.ambiguity_mask().empty();
+    size_t clean_from = 0; // first start whose k-mer holds no ambiguous base
+    for (size_t i = 0; has_ambiguity && i + 1 < k; ++i) {
+        if (g.is_ambiguous(i)) clean_from = i + 1;
+    }
+    for (size_t pos = 0; pos <= last; ++pos) {
+        if (has_ambiguity && g.is_ambiguous(pos + k - 1)) clean_from = pos + k;
+        if (pos >= clean_from) f(pos, packed_window(g, pos) & mask);
+    }
+}
+
+// Counts k-mers in an open addressing table with linear probing. Keys are
+// whole 2k-bit k-mers, so the one key equal to the empty marker is counted
+// on the side.
+class KmerCounter {
+public:
+    explicit KmerCounter(size_t expected = 1024) {
+        slots_.resize(std::bit_ceil(std::max<size_t>(2 * expected, 16)), {empty, 0});
+    }
+
+    void add(uint64_t kmer, uint32_t n = 1) {
+        if (kmer == empty) {
+            if (!empty_count_) ++size_;
+            empty_count_ += n;
+            return;
+        }
+        auto& slot = slots_[slot_index(kmer)];
+        if (slot.first == empty) {
+            slot.first = kmer;
+            if (++size_ * 2 > slots_.size()) {
+                slot.second = n;
+                grow();
+                return;
+            }
+        }
+        slot.second += n;
+    }
+
+    uint32_t count(uint64_t kmer) const {
+        if (kmer == empty) return empty_count_;
+        const auto& slot = slots_[slot_index(kmer)];
+        return slot.first == empty ? 0 : slot.second;
+    }
+
+    // Number of distinct k-mers.
+    size_t size() const { return size_; }
+
+    template <typename F>
+    void for_each(F f) const {
+        for (const auto& [kmer, n] : slots_) {
+            if (kmer != empty) f(kmer, n);
+        }
+        if (empty_count_) f(empty, empty_count_);
+    }
+
+    // The n most frequent k-mers, most frequent first.
+    std::vector<std::pair<uint64_t, uint32_t>> top(size_t n) const {
+        std::vector<std::pair<uint64_t, uint32_t>> all;
+        all.reserve(size_);
+        for_each([&all](uint64_t kmer, uint32_t c) { all.push_back({kmer, c}); });
+        auto by_count = [](const auto& lhs, const auto& rhs) {
+            return lhs.second > rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+        };
+        n = std::min(n, all.size());
+        std::partial_sort(all.begin(), all.begin() + n, all.end(), by_count);
+        all.resize(n);
+        return all;
+    }
+
+private:
+    static constexpr uint64_t empty = ~uint64_t{0};
+
+    std::vector<std::pair<uint64_t, uint32_t>> slots_;
+    size_t size_ = 0;
+    uint32_t empty_count_ = 0;
+
+    static uint64_t hash(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        return x ^ (x >> 33);
+    }
+
+    // The slot holding kmer, or the empty slot where it would go.
+    size_t slot_index(uint64_t kmer) const {
+        const auto mask = slots_.size() - 1;
+        for (auto i = hash(kmer) & mask;; i = (i + 1) & mask) {
+            if (slots_[i].first == kmer || slots_[i].first == empty) return i;
+        }
+    }
+
+    void grow() {
+        auto old = std::exchange(slots_, std::vector<std::pair<uint64_t, uint32_t>>(2 * slots_.size(), {empty, 0}));
+        for (const auto& slot : old) {
+            if (slot.first != empty) slots_[slot_index(slot.first)] = slot;
+        }
+    }
+};
+
+inline KmerCounter count_kmers(const PackedGene& g, unsigned k) {
+    KmerCounter counter{std::min<size_t>(g.size(), size_t{1} << std::min(2 * k, 24u))};
+    for_each_kmer(g, k, [&counter](size_t, uint64_t kmer) { counter.add(kmer); });
+    return counter;
+}
+
+// Bit 2i is set where base i of the two windows differs: XOR, then fold
+// each 2-bit pair onto its low bit.
+inline uint64_t mismatch_bits(uint64_t a, uint64_t b) {
+    const auto x = a ^ b;
+    return (x | (x >> 1)) & 0x5555555555555555ULL;
+}
+
+// Spreads bit i of m to bit 2i, turning a per-base mask into a 2-bit one.
+inline uint64_t spread_bits(uint32_t m) {
+    uint64_t x = m;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    x = (x | (x << 1)) & 0x5555555555555555ULL;
+    return x;
+}
+
+// Calls f(pos, mismatches) for every position where pattern matches g with
+// at most max_mismatches substitutions. An ambiguous base in g never
+// matches. The pattern must be ACGT only.
+template <typename F>
+void search(const PackedGene& g, std::string_view pattern, unsigned max_mismatches, F f) {
+    if (pattern.empty() || pattern.size() > g.size()) return;
+    const PackedGene p{pattern};
+    if (!p.ambiguity_mask().empty()) throw std::invalid_argument{"pattern must only contain ACGT"};
+    const auto m = p.size();
+    const auto& pattern_words = p.words();
+    const auto last_word = pattern_words.size() - 1;
+    const auto last_bits = (m % PackedGene::bases_per_word) ? kmer_mask(m % PackedGene::bases_per_word) : ~uint64_t{0};
+    const auto has_ambiguity = !g.ambiguity_mask().empty();
+    for (size_t pos = 0; pos + m <= g.size(); ++pos) {
+        unsigned mismatches = 0;
+        for (size_t j = 0; j <= last_word && mismatches <= max_mismatches; ++j) {
+            const auto at = pos + j * PackedGene::bases_per_word;
+            auto differ = mismatch_bits(packed_window(g, at), pattern_words[j]);
+            if (has_ambiguity) differ |= spread_bits(ambiguity_window(g, at));
+            if (j == last_word) differ &= last_bits;
+            mismatches += std::popcount(differ);
+        }
+        if (mismatches <= max_mismatches) f(pos, mismatches);
+    }
+}
+
+struct Match {
+    size_t pos;
+    unsigned mismatches;
+};
+
+inline std::vector<Match> find_all(const PackedGene& g, std::string_view pattern, unsigned max_mismatches = 0) {
+    std::vector<Match> matches;
+    search(g, pattern, max_mismatches, [&matches](size_t pos, unsigned mismatches) {
+            matches.push_back({pos, mismatches});
+            });
+    return matches;
+}
+
+#endif
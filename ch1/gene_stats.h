@@ -0,0 +1,115 @@
+#ifndef GENE_STATS_H
+#define GENE_STATS_H
+
+#include "gene_search.h"
+#include "packed_gene.h"
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Whole-sequence statistics computed a word (32 bases) at a time on the
+// packed representation.
+
+// Ambiguity mask bits for the 32 bases of packed word w.
+inline uint32_t ambiguity_bits(const std::vector<uint64_t>& mask, size_t w) {
+    return mask.empty() ? 0 : static_cast<uint32_t>(mask[w / 2] >> (32 * (w % 2)));
+}
+
+// Number of C and G bases. C (01) and G (10) are the codes whose two bits
+// differ; ambiguous bases are stored as A, so they never count.
+inline uint64_t gc_count(const PackedGene& g) {
+    uint64_t n = 0;
+    for (const auto w : g.words()) n += std::popcount((w ^ (w >> 1)) & 0x5555555555555555ULL);
+    return n;
+}
+
+// Fraction of C and G among the unambiguous bases.
+inline double gc_content(const PackedGene& g) {
+    uint64_t ambiguous = 0;
+    for (const auto m : g.ambiguity_mask()) ambiguous += std::popcount(m);
+    const auto known = g.size() - ambiguous;
+    return known ? static_cast<double>(gc_count(g)) / known : 0.0;
+}
+
+// Number of positions where two equal-length genes differ. An ambiguous
+// base on either side always counts as a difference.
+inline uint64_t hamming_distance(const PackedGene& a, const PackedGene& b) {
+    if (a.size() != b.size()) throw std::invalid_argument{"hamming distance needs equal lengths"};
+    const auto& wa = a.words();
+    const auto& wb = b.words();
+    uint64_t n = 0;
+    for (size_t w = 0; w < wa.size(); ++w) {
+        auto differ = mismatch_bits(wa[w], wb[w]);
+        differ |= spread_bits(ambiguity_bits(a.ambiguity_mask(), w) | ambiguity_bits(b.ambiguity_mask(), w));
+        n += std::popcount(differ);
+    }
+    return n;
+}
+
+// Reverses the order of the 2-bit groups in a word.
+inline uint64_t reverse_pairs(uint64_t x) {
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return __builtin_bswap64(x);
+}
+
+inline uint64_t reverse_bits(uint64_t x) {
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    return reverse_pairs(x);
+}
+
+// Reverses a bit string of `bits` bits stored in words: reverse every word,
+// reverse the word order, then shift out the padding that moved to the
+// front.
+template <typename ReverseWord>
+std::vector<uint64_t> reverse_bit_string(const std::vector<uint64_t>& words, size_t bits, ReverseWord reverse_word) {
+    const auto n = words.size();
+    std::vector<uint64_t> reversed(n);
+    for (size_t i = 0; i < n; ++i) reversed[i] = reverse_word(words[n - 1 - i]);
+    const auto pad = n * 64 - bits;
+    if (pad == 0) return reversed;
+    for (size_t i = 0; i < n; ++i) {
+        reversed[i] = (reversed[i] >> pad) | (i + 1 < n ? reversed[i + 1] << (64 - pad) : 0);
+    }
+    return reversed;
+}
+
+// IUPAC complement, keeping the case.
+inline char complement(char c) {
+    if ('a' <= c && c <= 'z') return static_cast<char>(complement(static_cast<char>(c - ('a' - 'A'))) + ('a' - 'A'));
+    switch (c) {
+        case 'A': return 'T'; case 'T': return 'A'; case 'C': return 'G'; case 'G': return 'C';
+        case 'R': return 'Y'; case 'Y': return 'R'; case 'K': return 'M'; case 'M': return 'K';
+        case 'B': return 'V'; case 'V': return 'B'; case 'D': return 'H'; case 'H': return 'D';
+        default: return c;
+    }
+}
+
+// Reverse complement. Complementing a code is flipping both of its bits
+// (A=00 <-> T=11, C=01 <-> G=10), so each word is inverted and its pairs
+// reversed; ambiguous bases are put back to A afterwards. Exception and
+// lowercase runs are mirrored.
+inline PackedGene reverse_complement(const PackedGene& g) {
+    const auto n = g.size();
+    auto words = reverse_bit_string(g.words(), 2 * n, [](uint64_t w) { return reverse_pairs(~w); });
+    std::vector<uint64_t> mask;
+    if (!g.ambiguity_mask().empty()) {
+        mask = reverse_bit_string(g.ambiguity_mask(), n, reverse_bits);
+        for (size_t w = 0; w < words.size(); ++w) words[w] &= ~(3 * spread_bits(ambiguity_bits(mask, w)));
+    }
+    std::vector<ExceptionRun> exceptions;
+    exceptions.reserve(g.exceptions().size());
+    for (auto it = g.exceptions().rbegin(); it != g.exceptions().rend(); ++it) {
+        exceptions.push_back({n - it->first - it->length, it->length, complement(it->c)});
+    }
+    std::vector<BaseRun> lowercase;
+    lowercase.reserve(g.lowercase().size());
+    for (auto it = g.lowercase().rbegin(); it != g.lowercase().rend(); ++it) {
+        lowercase.push_back({n - it->first - it->length, it->length});
+    }
+    return PackedGene::from_parts(n, std::move(words), std::move(mask), std::move(exceptions), std::move(lowercase));
+}
+
+#endif
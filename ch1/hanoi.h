@@ -0,0 +1,94 @@
+#ifndef HANOI_H
+#define HANOI_H
+
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// The optimal Towers of Hanoi solution, move by move, without recursion or
+// towers. Pegs are 0 (A, the start), 1 (B, the goal) and 2 (C), and disk 0
+// is the smallest.
+//
+// Move m (counting from 1) moves disk ctz(m), and it is that disk's
+// (m >> (d + 1))-th move. Every disk always steps the same way around the
+// pegs: the largest goes A -> B, and each smaller disk turns the other way
+// from the one below it. So the whole move follows from the bits of m.
+
+struct HanoiMove {
+    unsigned disk;
+    unsigned from, to;
+};
+
+// Total number of moves for n disks, 2^n - 1; n may be up to 64.
+inline uint64_t hanoi_moves(unsigned n) {
+    assert(n <= 64);
+    return n == 64 ? ~uint64_t{0} : (uint64_t{1} << n) - 1;
+}
+
+// +1 if disk d steps A -> B -> C -> A, 2 (that is, -1) if it steps the
+// other way.
+inline unsigned hanoi_step(unsigned n, unsigned d) {
+    return (n - d) % 2 ? 1 : 2;
+}
+
+// Move m of the solution for n disks, 1 <= m <= hanoi_moves(n).
+inline HanoiMove hanoi_move(unsigned n, uint64_t m) {
+    assert(m >= 1 && m <= hanoi_moves(n));
+    const auto d = static_cast<unsigned>(std::countr_zero(m));
+    const auto step = hanoi_step(n, d);
+    const auto from = static_cast<unsigned>(((d + 1 < 64 ? m >> (d + 1) : 0) % 3) * step % 3);
+    return {d, from, (from + step) % 3};
+}
+
+// Calls f(m, move) for moves first .. first + count - 1.
+template <typename F>
+void for_each_hanoi_move(unsigned n, uint64_t first, uint64_t count, F f) {
+    for (uint64_t i = 0; i < count; ++i) f(first + i, hanoi_move(n, first + i));
+}
+
+// Configurations are strings with one peg letter (A, B or C) per disk,
+// largest disk first, so "AB" has the largest disk on A and the smallest
+// on B. That is the order Hanoi labels the disks in, 1 being the largest.
+
+// The configuration after the first k moves. Disk d has moved once for
+// every m <= k with ctz(m) == d, which is ceil((k >> d) / 2) times.
+inline std::string hanoi_state(unsigned n, uint64_t k) {
+    assert(n <= 64 && k <= hanoi_moves(n));
+    std::string state(n, 'A');
+    for (unsigned d = 0; d < n; ++d) {
+        const auto moves = (k >> d) / 2 + ((k >> d) & 1);
+        state[n - 1 - d] = "ABC"[(moves % 3) * hanoi_step(n, d) % 3];
+    }
+    return state;
+}
+
+// The number of moves after which the solution is in the given
+// configuration, or nothing if it never is. Going from the largest disk
+// down: a disk still on its source means the smaller ones are on their way
+// to the spare peg; a disk on its target means its move, and the 2^d moves
+// before it, are done and the smaller ones now head from the spare peg to
+// the target; anywhere else is not on the optimal path.
+inline std::optional<uint64_t> hanoi_index(std::string_view state) {
+    const auto n = state.size();
+    if (n > 64) return std::nullopt;
+    char from = 'A', to = 'B', spare = 'C';
+    uint64_t k = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const auto d = n - 1 - i;
+        if (state[i] == from) {
+            std::swap(to, spare);
+        } else if (state[i] == to) {
+            k += uint64_t{1} << d;
+            std::swap(from, spare);
+        } else {
+            return std::nullopt;
+        }
+    }
+    return k;
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+inline std::system_error os_error(const std::string& what) {
+    return {errno, std::generic_category(), what};
+}
+
+// A whole file mapped into memory, read-only, read-write, or private:
+// writable, with writes kept in this process's copy of the pages and
+// never reaching the file. An empty file maps to a null pointer with
+// size 0.
+class MappedFile {
+public:
+    enum class Mode { Read, ReadWrite, Private };
+
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path, Mode mode = Mode::Read) {
+        const auto fd = ::open(path.c_str(), mode == Mode::ReadWrite ? O_RDWR : O_RDONLY);
+        if (fd < 0) throw os_error("open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) < 0) {
+            const auto e = os_error("stat " + path);
+            ::close(fd);
+            throw e;
+        }
+        size_ = st.st_size;
+        if (size_ > 0) {
+            const auto prot = mode == Mode::Read ? PROT_READ : PROT_READ | PROT_WRITE;
+            const auto flags = mode == Mode::Private ? MAP_PRIVATE : MAP_SHARED;
+            const auto p = ::mmap(nullptr, size_, prot, flags, fd, 0);
+            if (p == MAP_FAILED) {
+                const auto e = os_error("mmap " + path);
+                ::close(fd);
+                throw e;
+            }
+            data_ = static_cast<char*>(p);
+        }
+        ::close(fd);
+    }
+
+    // Creates (or truncates) path to size bytes and maps it read-write. An
+    // existing file that grants more than mode is narrowed to mode, so
+    // secrets such as key material can ask for 0600. The blocks are
+    // allocated up front: a full disk is an error here rather than a
+    // SIGBUS on some later write through the mapping.
+    static MappedFile create(const std::string& path, size_t size, mode_t mode = 0644) {
+        const auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, mode);
+        if (fd < 0) throw os_error("open " + path);
+        auto fail = [fd](const std::system_error& e) {
+            ::close(fd);
+            return e;
+        };
+        struct stat st;
+        if (::fstat(fd, &st) < 0) throw fail(os_error("stat " + path));
+        if ((st.st_mode & 07777 & ~mode) && ::fchmod(fd, st.st_mode & mode) < 0) throw fail(os_error("chmod " + path));
+        if (size > 0) {
+            if (const auto e = ::posix_fallocate(fd, 0, size)) {
+                throw fail(std::system_error{e, std::generic_category(), "allocate " + path});
+            }
+        }
+        ::close(fd);
+        return MappedFile{path, Mode::ReadWrite};
+    }
+
+    MappedFile(MappedFile&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~MappedFile() {
+        if (data_) ::munmap(data_, size_);
+    }
+
+    char* data() { return data_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // Hints the kernel about the access pattern of the whole mapping.
+    void advise(int advice) const {
+        if (data_) ::madvise(data_, size_, advice);
+    }
+
+private:
+    char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif
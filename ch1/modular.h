@@ -0,0 +1,119 @@
+#ifndef MODULAR_H
+#define MODULAR_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+// a * b mod m without overflow for any 64-bit operands.
+inline uint64_t mulmod(uint64_t a, uint64_t b, uint64_t m) {
+    return static_cast<uint64_t>(static_cast<uint128_t>(a) * b % m);
+}
+
+inline uint64_t addmod(uint64_t a, uint64_t b, uint64_t m) {
+    return a >= m - b ? a - (m - b) : a + b;
+}
+
+inline uint128_t gcd128(uint128_t a, uint128_t b) {
+    while (b) a = std::exchange(b, a % b);
+    return a;
+}
+
+inline uint64_t powmod(uint64_t b, uint64_t e, uint64_t m) {
+    uint64_t r = 1 % m;
+    b %= m;
+    for (; e; e >>= 1) {
+        if (e & 1) r = mulmod(r, b, m);
+        b = mulmod(b, b, m);
+    }
+    return r;
+}
+
+// Deterministic Miller-Rabin; these bases cover every 64-bit integer.
+inline bool is_prime(uint64_t n) {
+    if (n < 2) return false;
+    for (uint64_t p : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+        if (n % p == 0) return n == p;
+    }
+    const auto s = std::countr_zero(n - 1);
+    const auto d = (n - 1) >> s;
+    for (uint64_t a : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+        auto x = powmod(a, d, n);
+        if (x == 1 || x == n - 1) continue;
+        auto composite = true;
+        for (int i = 1; i < s && composite; ++i) {
+            x = mulmod(x, x, n);
+            composite = x != n - 1;
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+// Returns a non-trivial factor of the odd composite n (Pollard-Brent rho).
+inline uint64_t pollard_rho(uint64_t n) {
+    for (uint64_t c = 1;; ++c) {
+        auto f = [n, c](uint64_t x) {
+            return static_cast<uint64_t>((static_cast<uint128_t>(mulmod(x, x, n)) + c) % n);
+        };
+        uint64_t x = 2, y = 2, ys = 2, q = 1, g = 1;
+        for (uint64_t r = 1; g == 1; r <<= 1) {
+            x = y;
+            for (uint64_t i = 0; i < r; ++i) y = f(y);
+            for (uint64_t k = 0; k < r && g == 1; k += 128) {
+                ys = y;
+                for (uint64_t i = 0; i < std::min<uint64_t>(128, r - k); ++i) {
+                    y = f(y);
+                    q = mulmod(q, x > y ? x - y : y - x, n);
+                }
+                g = std::gcd(q, n);
+            }
+        }
+        if (g == n) {
+            // The batched gcd overshot; retrace one step at a time.
+            do {
+                ys = f(ys);
+                g = std::gcd(x > ys ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
+        if (g != n) return g;
+    }
+}
+
+// Prime factorization as (prime, exponent) pairs in increasing prime order.
+inline std::vector<std::pair<uint64_t, unsigned>> factorize(uint64_t n) {
+    std::vector<uint64_t> primes;
+    for (uint64_t p : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+        while (n % p == 0) {
+            primes.push_back(p);
+            n /= p;
+        }
+    }
+    std::vector<uint64_t> pending;
+    if (n > 1) pending.push_back(n);
+    while (!pending.empty()) {
+        const auto k = pending.back();
+        pending.pop_back();
+        if (is_prime(k)) {
+            primes.push_back(k);
+        } else {
+            const auto d = pollard_rho(k);
+            pending.push_back(d);
+            pending.push_back(k / d);
+        }
+    }
+    std::sort(primes.begin(), primes.end());
+    std::vector<std::pair<uint64_t, unsigned>> factors;
+    for (const auto p : primes) {
+        if (factors.empty() || factors.back().first != p) factors.push_back({p, 0});
+        ++factors.back().second;
+    }
+    return factors;
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef ONE_TIME_PAD_H
+#define ONE_TIME_PAD_H
+
+#include "cpu_features.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <sys/random.h>
+#include <system_error>
+
+// One-time pad primitives working in place on caller-owned buffers: the
+// key comes from the kernel CSPRNG in large getrandom(2) calls and the XOR
+// runs 16 or 32 bytes at a time, so nothing on the hot path allocates.
+
+using byte_span = std::span<unsigned char>;
+using const_byte_span = std::span<const unsigned char>;
+
+// Fills out with cryptographically secure random bytes. getrandom returns
+// at most 32 MiB per call, so large keys take a few calls.
+inline void fill_random(byte_span out) {
+    constexpr size_t max_call = size_t{1} << 25;
+    while (!out.empty()) {
+        const auto n = ::getrandom(out.data(), std::min(out.size(), max_call), 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::system_error{errno, std::generic_category(), "getrandom"};
+        }
+        out = out.subspan(n);
+    }
+}
+
+namespace otp_detail {
+
+inline void xor_scalar(unsigned char* out, const unsigned char* a, const unsigned char* b, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x, y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        x ^= y;
+        std::memcpy(out + i, &x, 8);
+    }
+    for (; i < n; ++i) out[i] = a[i] ^ b[i];
+}
+
+#if HAVE_X86_KERNELS
+// SSE2 is part of x86-64, so this needs no runtime check.
+inline void xor_sse2(unsigned char* out, const unsigned char* a, const unsigned char* b, size_t n) {
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        for (size_t j = 0; j < 64; j += 16) {
+            const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + j));
+            const auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + j));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + j), _mm_xor_si128(x, y));
+        }
+    }
+    xor_scalar(out + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void xor_avx2(unsigned char* out, const unsigned char* a,
+                                                     const unsigned char* b, size_t n) {
+    size_t i = 0;
+    for (; i + 128 <= n; i += 128) {
+        for (size_t j = 0; j < 128; j += 32) {
+            const auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + j));
+            const auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + j));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + j), _mm256_xor_si256(x, y));
+        }
+    }
+    xor_scalar(out + i, a + i, b + i, n - i);
+}
+#endif
+
+using XorKernel = void (*)(unsigned char*, const unsigned char*, const unsigned char*, size_t);
+
+inline XorKernel pick_xor() {
+#if HAVE_X86_KERNELS
+    return cpu_has_avx2() ? xor_avx2 : xor_sse2;
+#else
+    return xor_scalar;
+#endif
+}
+
+} // namespace otp_detail
+
+// out = a ^ b. All three have the same size; out may be a or b.
+inline void xor_bytes(byte_span out, const_byte_span a, const_byte_span b) {
+    if (a.size() != out.size() || b.size() != out.size()) throw std::invalid_argument{"xor_bytes: size mismatch"};
+    static const auto kernel = otp_detail::pick_xor();
+    kernel(out.data(), a.data(), b.data(), out.size());
+}
+
+// Fills key with a fresh pad and encrypts data with it in place.
+inline void encrypt_in_place(byte_span data, byte_span key) {
+    fill_random(key);
+    xor_bytes(data, data, key);
+}
+
+inline void decrypt_in_place(byte_span data, const_byte_span key) {
+    xor_bytes(data, data, key);
+}
+
+#endif
@@ -0,0 +1,530 @@
+#ifndef PACKED_GENE_H
+#define PACKED_GENE_H
+
+#include "cpu_features.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Nucleotide codes, matching the bit pairs used by compress() in gene.cc.
+enum class Base : uint8_t { A = 0, C = 1, G = 2, T = 3 };
+
+// serialize() copies the words out as they are in memory.
+static_assert(std::endian::native == std::endian::little, "packed gene images hold little-endian words");
+
+namespace packed_gene_detail {
+
+constexpr char nucleotides[] = "ACGT";
+constexpr uint8_t invalid_code = 4;
+
+constexpr std::array<uint8_t, 256> make_encode_table() {
+    std::array<uint8_t, 256> t{};
+    for (auto& code : t) code = invalid_code;
+    for (uint8_t code = 0; code < 4; ++code) t[static_cast<uint8_t>(nucleotides[code])] = code;
+    return t;
+}
+
+// Four packed bases per byte, decoded to four chars in memory order.
+constexpr std::array<std::array<char, 4>, 256> make_decode_table() {
+    std::array<std::array<char, 4>, 256> t{};
+    for (unsigned byte = 0; byte < 256; ++byte) {
+        for (unsigned i = 0; i < 4; ++i) t[byte][i] = nucleotides[(byte >> (2 * i)) & 3];
+    }
+    return t;
+}
+
+inline constexpr auto encode_table = make_encode_table();
+inline constexpr auto decode_table = make_decode_table();
+
+// Packs 32 chars into one word; bit i of invalid is set where p[i] is not
+// one of ACGT (its code is left as 0).
+inline uint64_t pack32_scalar(const char* p, uint32_t& invalid) {
+    uint64_t word = 0;
+    invalid = 0;
+    for (unsigned i = 0; i < 32; ++i) {
+        const auto code = encode_table[static_cast<uint8_t>(p[i])];
+        if (code == invalid_code) invalid |= uint32_t{1} << i;
+        else word |= uint64_t{code} << (2 * i);
+    }
+    return word;
+}
+
+#if HAVE_X86_KERNELS
+// ACGT are told apart by their low nibble (A=1, C=3, T=4, G=7), so one
+// shuffle maps chars to codes and a second one gives the only char each
+// nibble may come from. Unused slots hold a byte whose low nibble differs
+// from the slot index, so they never compare equal.
+#define PACKED_GENE_CODE_LUT 0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0
+#define PACKED_GENE_CHAR_LUT 1, 'A', 3, 'C', 'T', 4, 7, 'G', 9, 8, 11, 10, 13, 12, 15, 14
+#define PACKED_GENE_LO_LUT 'A', 'C', 'G', 'T', 'A', 'C', 'G', 'T', 'A', 'C', 'G', 'T', 'A', 'C', 'G', 'T'
+#define PACKED_GENE_HI_LUT 'A', 'A', 'A', 'A', 'C', 'C', 'C', 'C', 'G', 'G', 'G', 'G', 'T', 'T', 'T', 'T'
+
+__attribute__((target("ssse3")))
+inline uint32_t pack16_ssse3(const char* p, uint32_t& invalid) {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const auto nibbles = _mm_and_si128(v, _mm_set1_epi8(0x0F));
+    const auto expected = _mm_shuffle_epi8(_mm_setr_epi8(PACKED_GENE_CHAR_LUT), nibbles);
+    const auto valid = _mm_cmpeq_epi8(v, expected);
+    const auto codes = _mm_and_si128(valid,
+            _mm_shuffle_epi8(_mm_setr_epi8(PACKED_GENE_CODE_LUT), nibbles));
+    invalid = ~_mm_movemask_epi8(valid) & 0xFFFF;
+    // Fold pairs of codes into nibbles, pairs of nibbles into bytes, then
+    // gather the low byte of each 32-bit lane.
+    const auto pairs = _mm_maddubs_epi16(codes, _mm_set1_epi16(0x0401));
+    const auto quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00100001));
+    const auto packed = _mm_shuffle_epi8(quads,
+            _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+}
+
+__attribute__((target("ssse3")))
+inline uint64_t pack32_ssse3(const char* p, uint32_t& invalid) {
+    uint32_t invalid_lo, invalid_hi;
+    const uint64_t lo = pack16_ssse3(p, invalid_lo);
+    const uint64_t hi = pack16_ssse3(p + 16, invalid_hi);
+    invalid = invalid_lo | (invalid_hi << 16);
+    return lo | (hi << 32);
+}
+
+__attribute__((target("avx2")))
+inline uint64_t pack32_avx2(const char* p, uint32_t& invalid) {
+    const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const auto nibbles = _mm256_and_si256(v, _mm256_set1_epi8(0x0F));
+    const auto expected = _mm256_shuffle_epi8(
+            _mm256_setr_epi8(PACKED_GENE_CHAR_LUT, PACKED_GENE_CHAR_LUT), nibbles);
+    const auto valid = _mm256_cmpeq_epi8(v, expected);
+    const auto codes = _mm256_and_si256(valid, _mm256_shuffle_epi8(
+            _mm256_setr_epi8(PACKED_GENE_CODE_LUT, PACKED_GENE_CODE_LUT), nibbles));
+    invalid = ~static_cast<uint32_t>(_mm256_movemask_epi8(valid));
+    const auto pairs = _mm256_maddubs_epi16(codes, _mm256_set1_epi16(0x0401));
+    const auto quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00100001));
+    const auto gathered = _mm256_shuffle_epi8(quads, _mm256_setr_epi8(
+            0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    const auto packed = _mm256_permutevar8x32_epi32(gathered, _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(_mm256_castsi256_si128(packed)));
+}
+
+// Expands 4 packed bytes to 16 chars. Every output lane picks its byte,
+// then the nibble holding its base, then the half of that nibble.
+__attribute__((target("ssse3")))
+inline void unpack16_ssse3(uint32_t bytes, char* out) {
+    const auto x = _mm_shuffle_epi8(_mm_cvtsi32_si128(static_cast<int>(bytes)),
+            _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3));
+    const auto low_nibble = _mm_set1_epi8(0x0F);
+    const auto lo = _mm_and_si128(x, low_nibble);
+    const auto hi = _mm_and_si128(_mm_srli_epi16(x, 4), low_nibble);
+    const auto use_hi = _mm_setr_epi8(0, 0, -1, -1, 0, 0, -1, -1, 0, 0, -1, -1, 0, 0, -1, -1);
+    const auto nibbles = _mm_or_si128(_mm_andnot_si128(use_hi, lo), _mm_and_si128(use_hi, hi));
+    const auto odd = _mm_setr_epi8(0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1);
+    const auto even_chars = _mm_shuffle_epi8(_mm_setr_epi8(PACKED_GENE_LO_LUT), nibbles);
+    const auto odd_chars = _mm_shuffle_epi8(_mm_setr_epi8(PACKED_GENE_HI_LUT), nibbles);
+    const auto chars = _mm_or_si128(_mm_andnot_si128(odd, even_chars), _mm_and_si128(odd, odd_chars));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chars);
+}
+
+__attribute__((target("ssse3")))
+inline void unpack32_ssse3(uint64_t word, char* out) {
+    unpack16_ssse3(static_cast<uint32_t>(word), out);
+    unpack16_ssse3(static_cast<uint32_t>(word >> 32), out + 16);
+}
+
+__attribute__((target("avx2")))
+inline void unpack32_avx2(uint64_t word, char* out) {
+    const auto x = _mm256_shuffle_epi8(
+            _mm256_broadcastsi128_si256(_mm_cvtsi64_si128(static_cast<long long>(word))),
+            _mm256_setr_epi8(
+                0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7));
+    const auto low_nibble = _mm256_set1_epi8(0x0F);
+    const auto lo = _mm256_and_si256(x, low_nibble);
+    const auto hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), low_nibble);
+    const auto use_hi = _mm256_setr_epi8(
+            0, 0, -1, -1, 0, 0, -1, -1, 0, 0, -1, -1, 0, 0, -1, -1,
+            0, 0, -1, -1, 0, 0, -1, -1, 0, 0, -1, -1, 0, 0, -1, -1);
+    const auto nibbles = _mm256_blendv_epi8(lo, hi, use_hi);
+    const auto even_chars = _mm256_shuffle_epi8(
+            _mm256_setr_epi8(PACKED_GENE_LO_LUT, PACKED_GENE_LO_LUT), nibbles);
+    const auto odd_chars = _mm256_shuffle_epi8(
+            _mm256_setr_epi8(PACKED_GENE_HI_LUT, PACKED_GENE_HI_LUT), nibbles);
+    const auto chars = _mm256_blendv_epi8(even_chars, odd_chars, _mm256_set1_epi16(static_cast<short>(0xFF00)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chars);
+}
+
+#undef PACKED_GENE_CODE_LUT
+#undef PACKED_GENE_CHAR_LUT
+#undef PACKED_GENE_LO_LUT
+#undef PACKED_GENE_HI_LUT
+#endif
+
+inline void unpack32_scalar(uint64_t word, char* out) {
+    for (unsigned i = 0; i < 8; ++i, out += 4) {
+        std::memcpy(out, decode_table[(word >> (8 * i)) & 0xFF].data(), 4);
+    }
+}
+
+using Pack32Fn = uint64_t (*)(const char*, uint32_t&);
+using Unpack32Fn = void (*)(uint64_t, char*);
+
+inline Pack32Fn pick_pack32() {
+#if HAVE_X86_KERNELS
+    if (cpu_has_avx2()) return pack32_avx2;
+    if (cpu_has_ssse3()) return pack32_ssse3;
+#endif
+    return pack32_scalar;
+}
+
+inline Unpack32Fn pick_unpack32() {
+#if HAVE_X86_KERNELS
+    if (cpu_has_avx2()) return unpack32_avx2;
+    if (cpu_has_ssse3()) return unpack32_ssse3;
+#endif
+    return unpack32_scalar;
+}
+
+}
+
+// A stretch of positions [first, first + length).
+struct BaseRun {
+    uint64_t first, length;
+    friend bool operator==(const BaseRun&, const BaseRun&) = default;
+};
+
+// A stretch of one character other than ACGT or N.
+struct ExceptionRun {
+    uint64_t first, length;
+    char c;
+    friend bool operator==(const ExceptionRun&, const ExceptionRun&) = default;
+};
+
+// A gene stored with 2 bits per nucleotide, 32 nucleotides per 64-bit word,
+// nucleotide i in bits [2i, 2i + 2) of its word.
+//
+// Case is kept apart from the bases: a lowercase (soft-masked) letter is
+// packed as its uppercase and its position recorded in a sorted list of
+// lowercase runs. Anything else other than ACGT is stored as A with its
+// bit set in a side mask (only allocated when needed); an 'N' needs nothing
+// else, any other char is also kept in a sorted list of exception runs, so
+// every input round-trips. Masked regions come in long runs, so both lists
+// stay short.
+class PackedGene {
+public:
+    static constexpr size_t bases_per_word = 32;
+
+    PackedGene() = default;
+
+    // Assembles a gene from its parts, as returned by words(),
+    // ambiguity_mask(), exceptions() and lowercase(); used by word-level
+    // transforms.
+    static PackedGene from_parts(size_t size, std::vector<uint64_t> words, std::vector<uint64_t> ambiguous,
+            std::vector<ExceptionRun> exceptions, std::vector<BaseRun> lowercase) {
+        assert(words.size() == word_count(size));
+        assert(ambiguous.empty() || ambiguous.size() == (size + 63) / 64);
+        assert(is_sorted_runs(exceptions, size) && is_sorted_runs(lowercase, size));
+        PackedGene g;
+        g.size_ = size;
+        g.words_ = std::move(words);
+        g.ambiguous_ = std::move(ambiguous);
+        g.exceptions_ = std::move(exceptions);
+        g.lowercase_ = std::move(lowercase);
+        return g;
+    }
+
+    explicit PackedGene(std::string_view gene) : size_(gene.size()) {
+        using namespace packed_gene_detail;
+        static const auto pack32 = pick_pack32();
+        words_.resize(word_count(size_));
+        size_t w = 0;
+        for (; (w + 1) * bases_per_word <= size_; ++w) {
+            uint32_t invalid;
+            words_[w] = pack32(gene.data() + w * bases_per_word, invalid);
+            if (invalid) words_[w] = pack_mixed(gene.data() + w * bases_per_word, w);
+        }
+        if (const auto rest = size_ - w * bases_per_word) {
+            char tail[bases_per_word];
+            std::memset(tail, 'A', bases_per_word);
+            std::memcpy(tail, gene.data() + w * bases_per_word, rest);
+            uint32_t invalid;
+            words_[w] = pack32_scalar(tail, invalid);
+            if (invalid) words_[w] = pack_mixed(tail, w);
+        }
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Packed words; bits past size() in the last word are zero.
+    const std::vector<uint64_t>& words() const { return words_; }
+
+    // One bit per nucleotide set where the input was not ACGT in either
+    // case, or empty if there was no such nucleotide.
+    const std::vector<uint64_t>& ambiguity_mask() const { return ambiguous_; }
+    const std::vector<ExceptionRun>& exceptions() const { return exceptions_; }
+    const std::vector<BaseRun>& lowercase() const { return lowercase_; }
+
+    Base base(size_t i) const {
+        assert(i < size_);
+        return static_cast<Base>((words_[i / bases_per_word] >> (2 * (i % bases_per_word))) & 3);
+    }
+
+    bool is_ambiguous(size_t i) const {
+        assert(i < size_);
+        return !ambiguous_.empty() && (ambiguous_[i / 64] >> (i % 64)) & 1;
+    }
+
+    char operator[](size_t i) const {
+        auto c = packed_gene_detail::nucleotides[static_cast<uint8_t>(base(i))];
+        if (is_ambiguous(i)) {
+            const auto it = first_run_from(exceptions_, i);
+            c = it != exceptions_.end() && it->first <= i ? it->c : 'N';
+        }
+        const auto it = first_run_from(lowercase_, i);
+        return it != lowercase_.end() && it->first <= i ? to_lower(c) : c;
+    }
+
+    std::string decompress() const { return decompress(0, size_); }
+
+    std::string decompress(size_t pos, size_t count) const {
+        std::string s(count, ' ');
+        decompress(pos, count, s.data());
+        return s;
+    }
+
+    // Writes nucleotides [pos, pos + count) to out.
+    void decompress(size_t pos, size_t count, char* out) const {
+        using namespace packed_gene_detail;
+        static const auto unpack32 = pick_unpack32();
+        assert(pos + count <= size_);
+        const auto end = pos + count;
+        auto i = pos;
+        auto p = out;
+        for (; i < end && i % bases_per_word; ++i) *p++ = nucleotides[static_cast<uint8_t>(base(i))];
+        for (; i + bases_per_word <= end; i += bases_per_word, p += bases_per_word) {
+            unpack32(words_[i / bases_per_word], p);
+        }
+        if (i < end) {
+            char tail[bases_per_word];
+            unpack32_scalar(words_[i / bases_per_word], tail);
+            std::memcpy(p, tail, end - i);
+        }
+        if (!ambiguous_.empty()) restore_ambiguous(pos, end, out);
+        for (auto it = first_run_from(lowercase_, pos); it != lowercase_.end() && it->first < end; ++it) {
+            const auto first = std::max<uint64_t>(it->first, pos);
+            const auto last = std::min<uint64_t>(it->first + it->length, end);
+            for (auto j = first; j < last; ++j) out[j - pos] = to_lower(out[j - pos]);
+        }
+    }
+
+    friend bool operator==(const PackedGene&, const PackedGene&) = default;
+
+    // Concatenates other onto the end of this gene, shifting its words
+    // into place rather than unpacking them.
+    void append(const PackedGene& other) {
+        const auto old_size = size_;
+        size_ += other.size_;
+        words_.resize(word_count(size_));
+        shift_in(words_, old_size / bases_per_word, 2 * (old_size % bases_per_word), other.words_);
+        if (!ambiguous_.empty() || !other.ambiguous_.empty()) {
+            ambiguous_.resize((size_ + 63) / 64);
+            if (!other.ambiguous_.empty()) shift_in(ambiguous_, old_size / 64, old_size % 64, other.ambiguous_);
+        }
+        for (auto r : other.exceptions_) {
+            r.first += old_size;
+            add_run(exceptions_, r);
+        }
+        for (auto r : other.lowercase_) {
+            r.first += old_size;
+            add_run(lowercase_, r);
+        }
+    }
+
+    // The first n nucleotides, copied a word at a time.
+    PackedGene prefix(size_t n) const {
+        assert(n <= size_);
+        PackedGene g;
+        g.size_ = n;
+        g.words_.assign(words_.begin(), words_.begin() + word_count(n));
+        if (n % bases_per_word) g.words_.back() &= (uint64_t{1} << (2 * (n % bases_per_word))) - 1;
+        if (!ambiguous_.empty()) {
+            g.ambiguous_.assign(ambiguous_.begin(), ambiguous_.begin() + (n + 63) / 64);
+            if (n % 64) g.ambiguous_.back() &= (uint64_t{1} << (n % 64)) - 1;
+        }
+        for (auto it = exceptions_.begin(); it != exceptions_.end() && it->first < n; ++it) {
+            g.exceptions_.push_back({it->first, std::min<uint64_t>(it->length, n - it->first), it->c});
+        }
+        for (auto it = lowercase_.begin(); it != lowercase_.end() && it->first < n; ++it) {
+            g.lowercase_.push_back({it->first, std::min<uint64_t>(it->length, n - it->first)});
+        }
+        return g;
+    }
+
+    // Appends a flat little-endian image to out:
+    //     size, mask word count, exception run count,
+    //     lowercase run count                          (4 x uint64)
+    //     packed words, mask words                     (uint64 each)
+    //     (first, length) of each exception run, then
+    //     of each lowercase run                        (2 x uint64 each)
+    //     exception run chars, zero padded to a multiple of 8 bytes
+    void serialize(std::vector<char>& out) const {
+        auto put = [&out](const void* p, size_t n) {
+            out.insert(out.end(), static_cast<const char*>(p), static_cast<const char*>(p) + n);
+        };
+        const uint64_t header[] = {size_, ambiguous_.size(), exceptions_.size(), lowercase_.size()};
+        put(header, sizeof(header));
+        put(words_.data(), words_.size() * sizeof(uint64_t));
+        put(ambiguous_.data(), ambiguous_.size() * sizeof(uint64_t));
+        for (const auto& r : exceptions_) {
+            const uint64_t run[] = {r.first, r.length};
+            put(run, sizeof(run));
+        }
+        put(lowercase_.data(), lowercase_.size() * sizeof(BaseRun));
+        for (const auto& r : exceptions_) out.push_back(r.c);
+        out.resize(out.size() + (8 - exceptions_.size() % 8) % 8, 0);
+    }
+
+    // Inverse of serialize(); throws std::runtime_error on a truncated or
+    // inconsistent image.
+    static PackedGene deserialize(const char* data, size_t n) {
+        auto take = [&data, &n](void* p, size_t bytes) {
+            if (bytes > n) throw std::runtime_error{"truncated packed gene"};
+            if (bytes == 0) return; // p may be an empty vector's null data()
+            std::memcpy(p, data, bytes);
+            data += bytes;
+            n -= bytes;
+        };
+        uint64_t header[4];
+        take(header, sizeof(header));
+        PackedGene g;
+        g.size_ = header[0];
+        if (header[1] != 0 && header[1] != (g.size_ + 63) / 64) {
+            throw std::runtime_error{"bad ambiguity mask size"};
+        }
+        if (header[0] / bases_per_word > n / sizeof(uint64_t) || header[1] > n || header[2] > n || header[3] > n) {
+            throw std::runtime_error{"truncated packed gene"};
+        }
+        g.words_.resize(word_count(g.size_));
+        take(g.words_.data(), g.words_.size() * sizeof(uint64_t));
+        g.ambiguous_.resize(header[1]);
+        take(g.ambiguous_.data(), g.ambiguous_.size() * sizeof(uint64_t));
+        g.exceptions_.resize(header[2]);
+        for (auto& r : g.exceptions_) {
+            take(&r.first, sizeof(r.first));
+            take(&r.length, sizeof(r.length));
+        }
+        g.lowercase_.resize(header[3]);
+        take(g.lowercase_.data(), g.lowercase_.size() * sizeof(BaseRun));
+        for (auto& r : g.exceptions_) take(&r.c, 1);
+        if (!is_sorted_runs(g.exceptions_, g.size_) || !is_sorted_runs(g.lowercase_, g.size_)) {
+            throw std::runtime_error{"bad run list"};
+        }
+        return g;
+    }
+
+private:
+    size_t size_ = 0;
+    std::vector<uint64_t> words_;
+    std::vector<uint64_t> ambiguous_;
+    std::vector<ExceptionRun> exceptions_;
+    std::vector<BaseRun> lowercase_;
+
+    static size_t word_count(size_t bases) { return (bases + bases_per_word - 1) / bases_per_word; }
+
+    static char to_lower(char c) { return static_cast<char>(c + ('a' - 'A')); }
+
+    // Non-empty runs in order, apart and inside [0, size).
+    template <typename Run>
+    static bool is_sorted_runs(const std::vector<Run>& runs, uint64_t size) {
+        uint64_t end = 0;
+        for (const auto& r : runs) {
+            if (r.first < end || r.length == 0 || r.length > size - r.first) return false;
+            end = r.first + r.length;
+        }
+        return true;
+    }
+
+    // The first run that ends after pos.
+    template <typename Run>
+    static typename std::vector<Run>::const_iterator first_run_from(const std::vector<Run>& runs, uint64_t pos) {
+        return std::partition_point(runs.begin(), runs.end(), [pos](const Run& r) { return r.first + r.length <= pos; });
+    }
+
+    // Appends r, which starts at or after the end of the last run, merging
+    // the two when r continues it.
+    static void add_run(std::vector<BaseRun>& runs, const BaseRun& r) {
+        if (!runs.empty() && runs.back().first + runs.back().length == r.first) runs.back().length += r.length;
+        else runs.push_back(r);
+    }
+    static void add_run(std::vector<ExceptionRun>& runs, const ExceptionRun& r) {
+        if (!runs.empty() && runs.back().first + runs.back().length == r.first && runs.back().c == r.c) {
+            runs.back().length += r.length;
+        } else {
+            runs.push_back(r);
+        }
+    }
+
+    // ORs src into dst starting at bit `shift` of dst[first]; dst must
+    // already be sized for the result and zero past its old contents.
+    static void shift_in(std::vector<uint64_t>& dst, size_t first, unsigned shift, const std::vector<uint64_t>& src) {
+        for (size_t j = 0; j < src.size(); ++j) {
+            dst[first + j] |= src[j] << shift;
+            if (shift && first + j + 1 < dst.size()) dst[first + j + 1] |= src[j] >> (64 - shift);
+        }
+    }
+
+    // Packs word w from p, 32 chars of which some are not ACGT: lowercase
+    // letters are recorded and packed as uppercase, what is still not ACGT
+    // is marked ambiguous. Padding past the end of the gene is 'A'.
+    uint64_t pack_mixed(const char* p, size_t w) {
+        using namespace packed_gene_detail;
+        static const auto pack32 = pick_pack32();
+        const auto first = w * bases_per_word;
+        char upper[bases_per_word];
+        uint64_t lower = 0;
+        for (unsigned i = 0; i < bases_per_word; ++i) {
+            const bool is_lower = 'a' <= p[i] && p[i] <= 'z';
+            lower |= uint64_t{is_lower} << i;
+            upper[i] = is_lower ? static_cast<char>(p[i] - ('a' - 'A')) : p[i];
+        }
+        while (lower) {
+            const auto start = std::countr_zero(lower);
+            const auto length = std::countr_one(lower >> start);
+            add_run(lowercase_, {first + start, static_cast<uint64_t>(length)});
+            lower &= ~(((uint64_t{1} << length) - 1) << start);
+        }
+        uint32_t invalid;
+        const auto word = pack32(upper, invalid);
+        if (!invalid) return word;
+        if (ambiguous_.empty()) ambiguous_.resize((size_ + 63) / 64);
+        ambiguous_[first / 64] |= uint64_t{invalid} << (first % 64);
+        for (; invalid; invalid &= invalid - 1) {
+            const auto i = std::countr_zero(invalid);
+            if (upper[i] != 'N') add_run(exceptions_, {first + i, 1, upper[i]});
+        }
+        return word;
+    }
+
+    void restore_ambiguous(size_t pos, size_t end, char* out) const {
+        for (auto w = pos / 64; w * 64 < end; ++w) {
+            auto bits = ambiguous_[w];
+            for (; bits; bits &= bits - 1) {
+                const auto i = w * 64 + std::countr_zero(bits);
+                if (pos <= i && i < end) out[i - pos] = 'N';
+            }
+        }
+        for (auto it = first_run_from(exceptions_, pos); it != exceptions_.end() && it->first < end; ++it) {
+            const auto first = std::max<uint64_t>(it->first, pos);
+            const auto last = std::min<uint64_t>(it->first + it->length, end);
+            std::memset(out + (first - pos), it->c, last - first);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include "cpu_features.h"
+#include <array>
+#include <cstdint>
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+// 3"). A counter-based generator: the output is a pure function of a 64-bit
+// key and a 128-bit counter, so any thread can produce draw i of a stream
+// directly, with no state to share or split.
+class Philox4x32 {
+public:
+    using Block = std::array<uint32_t, 4>;
+
+    static constexpr uint32_t multiplier0 = 0xD2511F53;
+    static constexpr uint32_t multiplier1 = 0xCD9E8D57;
+    static constexpr uint32_t weyl0 = 0x9E3779B9;
+    static constexpr uint32_t weyl1 = 0xBB67AE85;
+    static constexpr int rounds = 10;
+
+    explicit Philox4x32(uint64_t seed = 0) : key_{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {}
+
+    std::array<uint32_t, 2> key() const { return key_; }
+
+    Block operator()(Block counter) const {
+        auto k0 = key_[0], k1 = key_[1];
+        for (int r = 0; r < rounds; ++r) {
+            const auto p0 = uint64_t{multiplier0} * counter[0];
+            const auto p1 = uint64_t{multiplier1} * counter[2];
+            counter = {static_cast<uint32_t>(p1 >> 32) ^ counter[1] ^ k0, static_cast<uint32_t>(p1),
+                       static_cast<uint32_t>(p0 >> 32) ^ counter[3] ^ k1, static_cast<uint32_t>(p0)};
+            k0 += weyl0;
+            k1 += weyl1;
+        }
+        return counter;
+    }
+
+    // Block number i of the stream.
+    Block operator()(uint64_t i) const {
+        return (*this)(Block{static_cast<uint32_t>(i), static_cast<uint32_t>(i >> 32), 0, 0});
+    }
+
+private:
+    std::array<uint32_t, 2> key_;
+};
+
+#if HAVE_X86_KERNELS
+// Full 32x32 -> 64 products of every lane; mul_epu32 only multiplies the
+// even lanes, so the odd ones are shifted down and done separately.
+__attribute__((target("avx2"))) inline void mulhilo_avx2(__m256i a, __m256i m, __m256i& hi, __m256i& lo) {
+    const auto even = _mm256_mul_epu32(a, m);
+    const auto odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+// Eight Philox blocks at once: c[j] holds word j of each of the eight
+// counters and receives word j of each output.
+__attribute__((target("avx2"))) inline void philox4x32_avx2(__m256i c[4], std::array<uint32_t, 2> key) {
+    const auto m0 = _mm256_set1_epi32(static_cast<int>(Philox4x32::multiplier0));
+    const auto m1 = _mm256_set1_epi32(static_cast<int>(Philox4x32::multiplier1));
+    auto k0 = key[0], k1 = key[1];
+    for (int r = 0; r < Philox4x32::rounds; ++r) {
+        __m256i hi0, lo0, hi1, lo1;
+        mulhilo_avx2(c[0], m0, hi0, lo0);
+        mulhilo_avx2(c[2], m1, hi1, lo1);
+        c[0] = _mm256_xor_si256(_mm256_xor_si256(hi1, c[1]), _mm256_set1_epi32(static_cast<int>(k0)));
+        c[1] = lo1;
+        c[2] = _mm256_xor_si256(_mm256_xor_si256(hi0, c[3]), _mm256_set1_epi32(static_cast<int>(k1)));
+        c[3] = lo0;
+        k0 += Philox4x32::weyl0;
+        k1 += Philox4x32::weyl1;
+    }
+}
+#endif
+
+#endif
@@ -1,4 +1,25 @@
+// pi.cc
+//
+//     pi [n]           the first n partial sums of the Leibniz series
+//     pi -t threads n  the sum of the first n Leibniz terms, in parallel
+//     pi -b [n]        terms per second for 1, 2, 4, ... threads
+//     pi -m samples [-s seed] [-t threads]
+//                      Monte Carlo estimate, reported at checkpoints
+//     pi -e [terms]    Euler transformed Leibniz series
+//     pi -c digits     Chudnovsky series, to the given number of decimals
+
+#include "pi.h"
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <numbers>
+#include <string>
+#include <thread>
+#include <unistd.h>
 
 double calculate_pi(unsigned n) {
     auto numerator = 4.0;
@@ -13,10 +34,95 @@ double calculate_pi(unsigned n) {
     return pi;
 }
 
+void benchmark(uint64_t n) {
+    const auto max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "terms: " << n << '\n';
+    double reference = 0;
+    double base_rate = 0;
+    for (unsigned threads = 1;; threads = std::min(2 * threads, max_threads)) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto pi = leibniz_sum(n, threads);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const auto rate = n / elapsed.count();
+        if (threads == 1) {
+            reference = pi;
+            base_rate = rate;
+        }
+        std::cout << std::setw(4) << threads << " threads " << std::scientific << std::setprecision(3)
+                  << rate << " terms/s " << std::fixed << std::setprecision(2) << rate / base_rate << 'x'
+                  << (std::memcmp(&pi, &reference, sizeof pi) ? "  MISMATCH" : "") << '\n';
+        if (threads == max_threads) break;
+    }
+    std::cout << std::setprecision(std::numeric_limits<double>::max_digits10) << std::defaultfloat
+              << "sum:   " << reference << '\n'
+              << "naive: " << calculate_pi(static_cast<unsigned>(std::min<uint64_t>(n, UINT32_MAX))) << '\n';
+}
+
+// Throws samples darts (rounded up to whole pairs) and reports the
+// estimate, its error and the throughput at every power of ten.
+void monte_carlo(uint64_t samples, uint64_t seed, unsigned threads) {
+    const auto pairs = (samples + 1) / 2;
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t done = 0, hits = 0;
+    std::cout << std::setw(14) << "samples" << std::setw(14) << "estimate" << std::setw(12) << "error"
+              << std::setw(14) << "samples/s" << '\n';
+    for (uint64_t checkpoint = 500; done < pairs; checkpoint *= 10) {
+        const auto upto = std::min(checkpoint, pairs);
+        hits += monte_carlo_hits(seed, done, upto - done, threads);
+        done = upto;
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const auto estimate = 4.0 * hits / (2 * done);
+        std::cout << std::setw(14) << 2 * done << std::fixed << std::setprecision(8) << std::setw(14) << estimate
+                  << std::scientific << std::setprecision(2) << std::setw(12) << std::abs(estimate - std::numbers::pi)
+                  << std::setw(14) << 2 * done / elapsed.count() << std::defaultfloat << '\n';
+    }
+}
+
 int main(int argc, char* argv[]) {
-    if (argc == 0) return 1;
-    auto n = std::stoi(argv[1]);
+    bool euler = false, bench = false;
+    unsigned digits = 0, threads = 0;
+    uint64_t samples = 0, seed = 1;
+    int c;
+    while ((c = getopt(argc, argv, "ebc:t:m:s:")) != -1) {
+        switch (c) {
+            case 'e': euler = true; break;
+            case 'b': bench = true; break;
+            case 't': threads = std::max(1, std::stoi(optarg)); break;
+            case 'c': digits = std::stoul(optarg); break;
+            case 'm': samples = std::stoull(optarg); break;
+            case 's': seed = std::stoull(optarg); break;
+            default: return 1;
+        }
+    }
+    if (digits) {
+        std::cout << chudnovsky_pi(digits) << '\n';
+        return 0;
+    }
+    if (samples) {
+        monte_carlo(samples, seed, threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
+        return 0;
+    }
+    if (bench) {
+        benchmark(optind < argc ? std::stoull(argv[optind]) : uint64_t{1} << 28);
+        return 0;
+    }
+    if (threads) {
+        if (optind >= argc) return 1;
+        std::cout << std::setprecision(std::numeric_limits<double>::max_digits10)
+                  << leibniz_sum(std::stoull(argv[optind]), threads) << '\n';
+        return 0;
+    }
+    if (euler) {
+        const auto terms = optind < argc ? std::stoul(argv[optind]) : 60;
+        std::cout << std::setprecision(std::numeric_limits<double>::max_digits10) << euler_pi(terms) << '\n';
+        return 0;
+    }
+    if (optind >= argc) return 1;
+    // Each line extends the previous partial sum by one term instead of
+    // calling calculate_pi(i) from scratch.
+    const auto n = std::stoi(argv[optind]);
+    LeibnizSeries series;
     for (int i = 1; i <= n; i++) {
-        std::cout << calculate_pi(i) << '\n';
+        std::cout << (i == 1 ? series.value() : series.next()) << '\n';
     }
 }
@@ -0,0 +1,330 @@
+#ifndef PI_H
+#define PI_H
+
+#include "bigint.h"
+#include "cpu_features.h"
+#include "philox.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Partial sums of the Leibniz series 4 - 4/3 + 4/5 - ..., one term per
+// call to next(). value() after n - 1 calls is the same double that
+// calculate_pi(n) returns, since the additions happen in the same order.
+class LeibnizSeries {
+public:
+    double value() const { return pi_; }
+    unsigned terms() const { return terms_; }
+
+    double next() {
+        pi_ += sign_ * numerator_ / denominator_;
+        denominator_ += 2.0;
+        sign_ *= -1;
+        ++terms_;
+        return pi_;
+    }
+
+private:
+    double numerator_ = 4.0;
+    double denominator_ = 3.0;
+    double pi_ = 4.0;
+    int sign_ = -1;
+    unsigned terms_ = 1;
+};
+
+namespace pi_detail {
+
+// Terms of the Leibniz series summed as one unit of work. The block size
+// and the order of every addition inside a block depend only on the term
+// range, never on which thread runs it, so the parallel sum below is bit
+// for bit the same for any thread count.
+inline constexpr uint64_t block_terms = uint64_t{1} << 16;
+inline constexpr unsigned lanes = 8;
+
+// One Kahan step: adds x to sum, carrying the lost low bits in c.
+inline void kahan_add(double& sum, double& c, double x) {
+    const auto y = x - c;
+    const auto t = sum + y;
+    c = (t - sum) - y;
+    sum = t;
+}
+
+// Folds the lanes pairwise in a fixed order.
+inline double reduce_lanes(const double* sum, const double* c) {
+    double v[lanes];
+    for (unsigned i = 0; i < lanes; ++i) v[i] = sum[i] - c[i];
+    for (unsigned width = lanes / 2; width > 0; width /= 2) {
+        for (unsigned i = 0; i < width; ++i) v[i] = v[2 * i] + v[2 * i + 1];
+    }
+    return v[0];
+}
+
+// Term k goes to lane k % 8; first is a multiple of 8, so even lanes hold
+// the positive terms.
+inline void leibniz_tail(uint64_t first, uint64_t count, double* sum, double* c) {
+    for (uint64_t k = first; k < first + count; ++k) {
+        kahan_add(sum[k % lanes], c[k % lanes], (k % 2 ? -4.0 : 4.0) / (2.0 * k + 1.0));
+    }
+}
+
+inline double leibniz_block_scalar(uint64_t first, uint64_t count) {
+    double sum[lanes] = {}, c[lanes] = {};
+    leibniz_tail(first, count, sum, c);
+    return reduce_lanes(sum, c);
+}
+
+#if HAVE_X86_KERNELS
+// The scalar kernel with the eight lanes in two AVX registers. Division is
+// correctly rounded in both, so the result is identical.
+__attribute__((target("avx2"))) inline double leibniz_block_avx2(uint64_t first, uint64_t count) {
+    const auto numerator = _mm256_setr_pd(4.0, -4.0, 4.0, -4.0);
+    const auto step = _mm256_set1_pd(2.0 * lanes);
+    const auto d0 = 2.0 * first + 1.0;
+    auto den_lo = _mm256_setr_pd(d0, d0 + 2, d0 + 4, d0 + 6);
+    auto den_hi = _mm256_setr_pd(d0 + 8, d0 + 10, d0 + 12, d0 + 14);
+    auto sum_lo = _mm256_setzero_pd(), sum_hi = _mm256_setzero_pd();
+    auto c_lo = _mm256_setzero_pd(), c_hi = _mm256_setzero_pd();
+    const auto full = count / lanes * lanes;
+    for (uint64_t i = 0; i < full; i += lanes) {
+        const auto y_lo = _mm256_sub_pd(_mm256_div_pd(numerator, den_lo), c_lo);
+        const auto y_hi = _mm256_sub_pd(_mm256_div_pd(numerator, den_hi), c_hi);
+        const auto t_lo = _mm256_add_pd(sum_lo, y_lo);
+        const auto t_hi = _mm256_add_pd(sum_hi, y_hi);
+        c_lo = _mm256_sub_pd(_mm256_sub_pd(t_lo, sum_lo), y_lo);
+        c_hi = _mm256_sub_pd(_mm256_sub_pd(t_hi, sum_hi), y_hi);
+        sum_lo = t_lo;
+        sum_hi = t_hi;
+        den_lo = _mm256_add_pd(den_lo, step);
+        den_hi = _mm256_add_pd(den_hi, step);
+    }
+    alignas(32) double sum[lanes], c[lanes];
+    _mm256_store_pd(sum, sum_lo);
+    _mm256_store_pd(sum + 4, sum_hi);
+    _mm256_store_pd(c, c_lo);
+    _mm256_store_pd(c + 4, c_hi);
+    leibniz_tail(first + full, count - full, sum, c);
+    return reduce_lanes(sum, c);
+}
+#endif
+
+inline double leibniz_block(uint64_t first, uint64_t count) {
+#if HAVE_X86_KERNELS
+    if (cpu_has_avx2()) return leibniz_block_avx2(first, count);
+#endif
+    return leibniz_block_scalar(first, count);
+}
+
+// Pairwise sum over a fixed tree, so the result only depends on the values.
+inline double pairwise_sum(std::span<const double> v) {
+    if (v.empty()) return 0.0;
+    if (v.size() == 1) return v[0];
+    const auto half = v.size() / 2;
+    return pairwise_sum(v.first(half)) + pairwise_sum(v.subspan(half));
+}
+
+} // namespace pi_detail
+
+// The first n terms of the Leibniz series summed on the given number of
+// threads: blocks of terms are handed out from an atomic counter, each
+// summed in eight compensated lanes, and the block sums added pairwise.
+// Far more accurate than calculate_pi(n), and independent of threads.
+inline double leibniz_sum(uint64_t n, unsigned threads = 1) {
+    const auto blocks = (n + pi_detail::block_terms - 1) / pi_detail::block_terms;
+    std::vector<double> partial(blocks);
+    std::atomic<uint64_t> next{0};
+    auto work = [&]() {
+        for (uint64_t b; (b = next++) < blocks;) {
+            const auto first = b * pi_detail::block_terms;
+            partial[b] = pi_detail::leibniz_block(first, std::min(pi_detail::block_terms, n - first));
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < std::min<uint64_t>(threads, blocks); ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    return pi_detail::pairwise_sum(partial);
+}
+
+namespace pi_detail {
+
+// Pairs of points handed to a thread at a time by monte_carlo_hits().
+inline constexpr uint64_t chunk_pairs = uint64_t{1} << 16;
+
+// Whether (x, y) lies in the quarter circle, in exact integer arithmetic:
+// with 31-bit coordinates the squares sum to less than 2^63.
+inline bool in_circle(uint32_t x, uint32_t y) {
+    const uint64_t a = x >> 1, b = y >> 1;
+    return a * a + b * b < (uint64_t{1} << 62);
+}
+
+// Each Philox block gives two points: words (0, 1) and (2, 3).
+inline uint64_t hits_scalar(const Philox4x32& rng, uint64_t first, uint64_t count) {
+    uint64_t hits = 0;
+    for (auto i = first; i < first + count; ++i) {
+        const auto r = rng(i);
+        hits += in_circle(r[0], r[1]) + in_circle(r[2], r[3]);
+    }
+    return hits;
+}
+
+#if HAVE_X86_KERNELS
+// Number of lanes where x^2 + y^2 < 2^62, as a negative count per 64-bit
+// lane (compare masks are -1).
+__attribute__((target("avx2"))) inline __m256i circle_mask_avx2(__m256i x, __m256i y) {
+    const auto limit = _mm256_set1_epi64x(int64_t{1} << 62);
+    x = _mm256_srli_epi32(x, 1);
+    y = _mm256_srli_epi32(y, 1);
+    const auto even = _mm256_add_epi64(_mm256_mul_epu32(x, x), _mm256_mul_epu32(y, y));
+    x = _mm256_srli_epi64(x, 32);
+    y = _mm256_srli_epi64(y, 32);
+    const auto odd = _mm256_add_epi64(_mm256_mul_epu32(x, x), _mm256_mul_epu32(y, y));
+    return _mm256_add_epi64(_mm256_cmpgt_epi64(limit, even), _mm256_cmpgt_epi64(limit, odd));
+}
+
+// Eight blocks, sixteen points, per iteration.
+__attribute__((target("avx2"))) inline uint64_t hits_avx2(const Philox4x32& rng, uint64_t first, uint64_t count) {
+    const auto full = count / 8 * 8;
+    const auto lane = _mm256_setr_epi64x(0, 1, 2, 3);
+    auto negative_hits = _mm256_setzero_si256();
+    for (auto i = first; i < first + full; i += 8) {
+        // 64-bit counters i..i+7 split into their low and high words.
+        const auto lo = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<int64_t>(i)), lane);
+        const auto hi = _mm256_add_epi64(lo, _mm256_set1_epi64x(4));
+        const auto words = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+        const auto a = _mm256_permutevar8x32_epi32(lo, words);
+        const auto b = _mm256_permutevar8x32_epi32(hi, words);
+        __m256i c[4] = {_mm256_permute2x128_si256(a, b, 0x20), _mm256_permute2x128_si256(a, b, 0x31),
+                        _mm256_setzero_si256(), _mm256_setzero_si256()};
+        philox4x32_avx2(c, rng.key());
+        negative_hits = _mm256_add_epi64(negative_hits, circle_mask_avx2(c[0], c[1]));
+        negative_hits = _mm256_add_epi64(negative_hits, circle_mask_avx2(c[2], c[3]));
+    }
+    alignas(32) int64_t sums[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(sums), negative_hits);
+    const auto hits = static_cast<uint64_t>(-(sums[0] + sums[1] + sums[2] + sums[3]));
+    return hits + hits_scalar(rng, first + full, count - full);
+}
+#endif
+
+inline uint64_t hits(const Philox4x32& rng, uint64_t first, uint64_t count) {
+#if HAVE_X86_KERNELS
+    if (cpu_has_avx2()) return hits_avx2(rng, first, count);
+#endif
+    return hits_scalar(rng, first, count);
+}
+
+} // namespace pi_detail
+
+// Monte Carlo darts: how many of the point pairs [first, first + pairs) of
+// the stream for seed land inside the quarter circle. Pair i is Philox
+// block i, so every point is fixed by the seed and its index alone and the
+// count does not depend on the number of threads.
+inline uint64_t monte_carlo_hits(uint64_t seed, uint64_t first, uint64_t pairs, unsigned threads = 1) {
+    const Philox4x32 rng{seed};
+    const auto chunks = (pairs + pi_detail::chunk_pairs - 1) / pi_detail::chunk_pairs;
+    std::atomic<uint64_t> next{0}, total{0};
+    auto work = [&]() {
+        uint64_t hits = 0;
+        for (uint64_t i; (i = next++) < chunks;) {
+            const auto offset = i * pi_detail::chunk_pairs;
+            hits += pi_detail::hits(rng, first + offset, std::min(pi_detail::chunk_pairs, pairs - offset));
+        }
+        total += hits;
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < std::min<uint64_t>(threads, chunks); ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    return total;
+}
+
+// Euler transform of the Leibniz series, done as van Wijngaarden's
+// repeated averaging: the partial sums of an alternating series overshoot
+// in turn, so averaging neighbours cancels most of the error. Each round
+// gains about a bit, so a few dozen terms reach double precision where the
+// plain series would need billions.
+inline double euler_pi(unsigned terms) {
+    if (terms == 0) return 0.0;
+    std::vector<double> sums;
+    sums.reserve(terms);
+    LeibnizSeries series;
+    sums.push_back(series.value());
+    while (sums.size() < terms) sums.push_back(series.next());
+    for (auto n = sums.size(); n-- > 1;) {
+        for (size_t i = 0; i < n; ++i) sums[i] = (sums[i] + sums[i + 1]) / 2;
+    }
+    return sums[0];
+}
+
+namespace pi_detail {
+
+// Just enough of a signed integer for the T term of the binary splitting.
+struct SignedBig {
+    BigUint magnitude;
+    bool negative = false;
+};
+
+inline SignedBig operator*(const SignedBig& lhs, const BigUint& rhs) {
+    return {lhs.magnitude * rhs, lhs.negative};
+}
+
+inline SignedBig operator+(const SignedBig& lhs, const SignedBig& rhs) {
+    if (lhs.negative == rhs.negative) return {lhs.magnitude + rhs.magnitude, lhs.negative};
+    if (lhs.magnitude < rhs.magnitude) return {rhs.magnitude - lhs.magnitude, rhs.negative};
+    return {lhs.magnitude - rhs.magnitude, lhs.negative};
+}
+
+struct Split {
+    BigUint p, q;
+    SignedBig t;
+};
+
+// 640320^3 / 24
+inline constexpr uint64_t c3_over_24 = 10939058860032000ULL;
+
+// P, Q and T over the terms [a, b) of the Chudnovsky series. Every term
+// after the first has a negative P, so only the magnitude of P(a, b) is
+// stored and its sign is recovered from the number of such terms.
+inline Split split(uint64_t a, uint64_t b) {
+    if (b - a == 1) {
+        if (a == 0) return {1, 1, {13591409, false}};
+        BigUint p = BigUint{6 * a - 5} * BigUint{2 * a - 1} * BigUint{6 * a - 1};
+        BigUint q = BigUint{a} * BigUint{a} * BigUint{a} * BigUint{c3_over_24};
+        SignedBig t = {p * BigUint{13591409 + 545140134 * a}, true};
+        return {std::move(p), std::move(q), std::move(t)};
+    }
+    const auto m = a + (b - a) / 2;
+    const auto left = split(a, m);
+    const auto right = split(m, b);
+    // T(a, b) = Q(m, b) T(a, m) + P(a, m) T(m, b)
+    auto shifted = right.t * left.p;
+    if ((m - a - (a == 0)) % 2 == 1) shifted.negative = !shifted.negative;
+    return {left.p * right.p, left.q * right.q, left.t * right.q + shifted};
+}
+
+} // namespace pi_detail
+
+// pi to the given number of decimal places by the Chudnovsky series with
+// binary splitting, formatted as "3.1415...". Every term adds about 14.18
+// digits, and the whole sum is one exact integer fraction, so the only
+// rounding is the final square root and division.
+inline std::string chudnovsky_pi(unsigned digits) {
+    constexpr unsigned guard = 10;
+    const auto precision = digits + guard;
+    const auto terms = static_cast<uint64_t>(precision / 14.181647462725477) + 1;
+    const auto s = pi_detail::split(0, terms);
+    // pi = 426880 sqrt(10005) Q / T, scaled by 10^precision.
+    const auto root = isqrt(BigUint{10005} * BigUint::pow10(2 * static_cast<size_t>(precision)));
+    assert(!s.t.negative);
+    auto text = (BigUint{426880} * root * s.q / s.t.magnitude).to_string();
+    text.resize(digits + 1);
+    return digits ? text.substr(0, 1) + '.' + text.substr(1) : text;
+}
+
+#endif
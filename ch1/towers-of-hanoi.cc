@@ -15,68 +15,166 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "buffered_writer.h"
+#include "hanoi.h"
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <iomanip>
 #include <iostream>
 #include <string>
-#include <sstream>
+#include <unistd.h>
 #include <vector>
 
+//     towers-of-hanoi [n]       solve and print the towers before and after
+//     towers-of-hanoi -m [n]    stream every move
+//     towers-of-hanoi -c [n]    number of moves
+//     towers-of-hanoi -b [n]    moves per second, over at most 2^28 moves
+//     towers-of-hanoi -k k [n]  configuration after move k, e.g. "BCA" for
+//                               disk 1 (largest) on B, 2 on C and 3 on A
+//     towers-of-hanoi -s state  move index at which state is reached
+//     towers-of-hanoi -V        check "k state" lines on stdin against the
+//                               solution, for validating move logs
+//
+// n is at most 64, so every move index fits in 64 bits.
+
 class Hanoi {
     private:
-        std::vector<char> towerA, towerB, towerC;
+        // Disk labels run from 1 (the largest, at the bottom) to n.
+        std::vector<unsigned> towers[3];
         size_t numberOfDisks;
-        std::string towerToString(const std::vector<char>& tower) {
-            std::stringstream tempResult;
+        std::string towerToString(const std::vector<unsigned>& tower) {
             std::string result;
             for(size_t i=0; i<tower.size(); i++) {
-                tempResult << tower[i] << (i==tower.size()-1 ? "" : ", ");
-                std::string temp;
-                tempResult >> temp;
-                result.append(temp);
+                if (i) result += ", ";
+                result += std::to_string(tower[i]);
             }
             return result;
         };
-        void move(std::vector<char>& begin, std::vector<char>& end,
-            std::vector<char>& temp, size_t n) {
-            if( n==1 ) {
-                char last = begin.back();
-                end.push_back(last);
-                begin.pop_back();
-            } else {
-                move(begin, temp, end, n-1);
-                move(begin, end, temp, 1);
-                move(temp, end, begin, n-1);
-            }
-
-        };
     public:
         Hanoi(size_t disks): numberOfDisks(disks) {
             for(size_t i=0; i<disks; i++) {
-                towerA.push_back(i+49);
+                towers[0].push_back(i+1);
             }
-        };
-        ~Hanoi() {
-
         };
         void solve() {
-            move(towerA, towerB, towerC, numberOfDisks);
+            for_each_hanoi_move(numberOfDisks, 1, hanoi_moves(numberOfDisks), [this](uint64_t, HanoiMove m) {
+                    towers[m.to].push_back(towers[m.from].back());
+                    towers[m.from].pop_back();
+                    });
         }
         void print() {
-            std::cout << "Tower A: [" << towerToString(towerA) << "]" << std::endl;
-            std::cout << "Tower B: [" << towerToString(towerB) << "]" << std::endl;
-            std::cout << "Tower C: [" << towerToString(towerC) << "]" << std::endl;
+            std::cout << "Tower A: [" << towerToString(towers[0]) << "]" << std::endl;
+            std::cout << "Tower B: [" << towerToString(towers[1]) << "]" << std::endl;
+            std::cout << "Tower C: [" << towerToString(towers[2]) << "]" << std::endl;
         };
 };
 
-int main(int argc, char* argv[]) {
+// Writes "m: disk d A -> B" lines, with the same disk labels as Hanoi.
+void stream_moves(BufferedWriter& out, unsigned n, uint64_t first, uint64_t count) {
+    for_each_hanoi_move(n, first, count, [&out, n](uint64_t m, HanoiMove move) {
+            out << m << ": disk " << n - move.disk << ' ' << "ABC"[move.from] << " -> " << "ABC"[move.to] << '\n';
+            });
+}
+
+// Returns the number of lines that do not match the solution.
+uint64_t verify(std::istream& in) {
+    uint64_t k, checked = 0, bad = 0;
+    std::string state;
+    while (in >> k >> state) {
+        ++checked;
+        if (state.size() > 64 || k > hanoi_moves(state.size()) || hanoi_state(state.size(), k) != state) {
+            if (++bad <= 10) std::cerr << "mismatch: " << k << ' ' << state << '\n';
+        }
+    }
+    std::cout << "checked: " << checked << ", mismatches: " << bad << '\n';
+    return bad;
+}
 
-    size_t towerHeight = 3;
-    if( argc>1 ) {
-        std::stringstream argParser;
-        argParser << argv[1];
-        argParser >> towerHeight;
+void benchmark(unsigned n) {
+    const auto count = std::min<uint64_t>(hanoi_moves(n), uint64_t{1} << 28);
+    auto rate = [count](auto f) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return count / elapsed.count();
+    };
+    uint64_t checksum = 0;
+    const auto generate = rate([&]() {
+            for_each_hanoi_move(n, 1, count, [&checksum](uint64_t, HanoiMove m) {
+                    checksum += m.disk * 9 + m.from * 3 + m.to;
+                    });
+            });
+    const auto fd = ::open("/dev/null", O_WRONLY);
+    const auto format = rate([&]() {
+            BufferedWriter out{fd, 1 << 20};
+            stream_moves(out, n, 1, count);
+            out.flush();
+            });
+    ::close(fd);
+    std::cout << "disks: " << n << ", moves: " << count << " (checksum " << checksum << ")\n"
+              << std::scientific << std::setprecision(3)
+              << "generate: " << generate << " moves/s\n"
+              << "stream:   " << format << " moves/s\n";
+}
+
+int main(int argc, char* argv[]) {
+    char mode = 0;
+    uint64_t k = 0;
+    std::string state;
+    int c;
+    while ((c = getopt(argc, argv, "mcbk:s:V")) != -1) {
+        switch (c) {
+            case 'm': case 'c': case 'b': case 'V': mode = c; break;
+            case 'k': mode = c; k = std::stoull(optarg); break;
+            case 's': mode = c; state = optarg; break;
+            default: return 1;
+        }
+    }
+    if (mode == 'V') {
+        std::ios::sync_with_stdio(false);
+        return verify(std::cin) ? 1 : 0;
+    }
+    if (mode == 's') {
+        const auto index = hanoi_index(state);
+        if (!index) {
+            std::cerr << state << " is not on the solution path\n";
+            return 1;
+        }
+        std::cout << *index << '\n';
+        return 0;
+    }
+    const unsigned towerHeight = optind < argc ? std::stoul(argv[optind]) : (mode == 'b' ? 64 : 3);
+    if (towerHeight > 64) {
+        std::cerr << "at most 64 disks\n";
+        return 1;
+    }
+    try {
+        switch (mode) {
+            case 'm': {
+                BufferedWriter out;
+                stream_moves(out, towerHeight, 1, hanoi_moves(towerHeight));
+                out.flush();
+                break;
+            }
+            case 'c': std::cout << hanoi_moves(towerHeight) << '\n'; break;
+            case 'b': benchmark(towerHeight); break;
+            case 'k':
+                if (k > hanoi_moves(towerHeight)) {
+                    std::cerr << towerHeight << " disks take only " << hanoi_moves(towerHeight) << " moves\n";
+                    return 1;
+                }
+                std::cout << hanoi_state(towerHeight, k) << '\n';
+                break;
+            default: {
+                Hanoi game(towerHeight);
+                game.print();
+                game.solve();
+                game.print();
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << argv[0] << ": " << e.what() << '\n';
+        return 1;
     }
-    Hanoi game(towerHeight);
-    game.print();
-    game.solve();
-    game.print();
-}
\ No newline at end of file
+}
@@ -15,47 +15,251 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "mapped_file.h"
+#include "one_time_pad.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fcntl.h>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
 #include <vector>
-#include <random>
+
+//     unbreakable-encryption [text]    encrypt and decrypt text
+//     unbreakable-encryption -b [MiB]  key generation and XOR throughput
+//     unbreakable-encryption [-j threads] -e input key cipher
+//     unbreakable-encryption -d cipher key output
+//
+// The file modes write a fresh pad the size of the input to key, so
+// plaintext = cipher ^ key, and never hold a whole file in memory. Key and
+// decrypted output are created readable by their owner only.
 
 typedef unsigned char byte;
 typedef std::vector<byte> byte_vector;
 typedef std::pair< byte_vector, byte_vector > key_pair;
 
-byte_vector randomKey(size_t length) {
-    byte_vector result(length);
-    std::random_device rd;
-    for(size_t i=0; i<length; i++) {
-        result[i] = rd();
-    }
-    return result;
+key_pair encrypt(const std::string &original) {
+    byte_vector encrypted(original.begin(), original.end());
+    byte_vector key(original.size());
+    encrypt_in_place(encrypted, key);
+    return std::make_pair(encrypted, key);
 };
 
-key_pair encrypt(const std::string &original) {
-    const byte_vector key = randomKey(original.size());
-    byte_vector encrypted(original.size());
+std::string decrypt(key_pair &keyPair) {
+    std::string result(keyPair.first.size(),' ');
+    xor_bytes({reinterpret_cast<byte*>(result.data()), result.size()}, keyPair.first, keyPair.second);
+    return result;
+}
 
-    for(size_t i=0; i<original.size(); i++) {
-        encrypted[i] = key[i] ^ original[i];
+// Encrypts input chunk by chunk on several threads. Each chunk gets its
+// own run of getrandom, so key generation, the slow part, scales with the
+// threads too. Key and ciphertext are written straight into shared file
+// mappings, with no copy through a user space buffer.
+void encrypt_file(const std::string& input, const std::string& key_path, const std::string& cipher_path,
+                  unsigned threads) {
+    constexpr size_t chunk_bytes = size_t{1} << 23;
+    const MappedFile in{input};
+    in.advise(MADV_SEQUENTIAL);
+    auto key = MappedFile::create(key_path, in.size(), 0600);
+    auto out = MappedFile::create(cipher_path, in.size());
+    const auto n = in.size();
+    const auto chunks = (n + chunk_bytes - 1) / chunk_bytes;
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&]() {
+        try {
+            for (size_t i; (i = next++) < chunks;) {
+                const auto offset = i * chunk_bytes;
+                const auto size = std::min(chunk_bytes, n - offset);
+                const byte_span pad{reinterpret_cast<byte*>(key.data()) + offset, size};
+                fill_random(pad);
+                xor_bytes({reinterpret_cast<byte*>(out.data()) + offset, size},
+                          {reinterpret_cast<const byte*>(in.data()) + offset, size}, pad);
+            }
+        } catch (...) {
+            // Keep the first error for the caller and stop handing out chunks.
+            const std::lock_guard lock{error_mutex};
+            if (!error) error = std::current_exception();
+            next = chunks;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < std::min<size_t>(threads, chunks); ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    if (error) std::rethrow_exception(error);
+}
+
+// Closes the descriptor when it goes out of scope. mode applies only when
+// flags include O_CREAT; a file that already exists is narrowed to it, as
+// MappedFile::create() does, but never widened.
+class FileDescriptor {
+public:
+    FileDescriptor(const std::string& path, int flags, mode_t mode = 0644) : fd_(::open(path.c_str(), flags, mode)) {
+        if (fd_ < 0) throw os_error("open " + path);
+        if (flags & O_CREAT) {
+            auto fail = [this](const std::system_error& e) {
+                ::close(fd_);
+                return e;
+            };
+            struct stat st;
+            if (::fstat(fd_, &st) < 0) throw fail(os_error("stat " + path));
+            if ((st.st_mode & 07777 & ~mode) && ::fchmod(fd_, st.st_mode & mode) < 0) throw fail(os_error("chmod " + path));
+        }
     }
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+    ~FileDescriptor() { ::close(fd_); }
 
-    return std::make_pair(encrypted, key);
+    int get() const { return fd_; }
+
+    size_t size() const {
+        struct stat st;
+        if (::fstat(fd_, &st) < 0) throw os_error("stat");
+        return st.st_size;
+    }
+
+    // Reads up to n bytes, fewer only at the end of the file.
+    size_t read(byte* p, size_t n) const {
+        size_t done = 0;
+        while (done < n) {
+            const auto got = ::read(fd_, p + done, n - done);
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                throw os_error("read");
+            }
+            if (got == 0) break;
+            done += got;
+        }
+        return done;
+    }
+
+    void write(const byte* p, size_t n) const {
+        while (n > 0) {
+            const auto written = ::write(fd_, p, n);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw os_error("write");
+            }
+            p += written;
+            n -= written;
+        }
+    }
+
+private:
+    int fd_;
 };
 
-std::string decrypt(key_pair &keyPair) {
-    std::string result(keyPair.first.size(),' ');
-    for(size_t i=0; i<result.size(); i++) {
-        result[i] = keyPair.first[i] ^ keyPair.second[i];
+// Streams ciphertext and key through two fixed buffers, so memory use does
+// not depend on the file size.
+void decrypt_file(const std::string& cipher_path, const std::string& key_path, const std::string& output) {
+    constexpr size_t block_bytes = size_t{1} << 22;
+    const FileDescriptor cipher{cipher_path, O_RDONLY}, key{key_path, O_RDONLY};
+    if (cipher.size() != key.size()) throw std::runtime_error{"key and ciphertext differ in size"};
+    ::posix_fadvise(cipher.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    ::posix_fadvise(key.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    // The output is plaintext, so it is as private as the key.
+    const FileDescriptor out{output, O_WRONLY | O_CREAT | O_TRUNC, 0600};
+    byte_vector data(block_bytes), pad(block_bytes);
+    while (const auto n = cipher.read(data.data(), block_bytes)) {
+        if (key.read(pad.data(), n) != n) throw std::runtime_error{"key is shorter than ciphertext"};
+        decrypt_in_place({data.data(), n}, {pad.data(), n});
+        out.write(data.data(), n);
     }
-    return result;
+}
+
+// GB/s of f over a buffer of n bytes, best of a few runs.
+template <typename F>
+double throughput(size_t n, F f) {
+    auto best = 0.0;
+    for (int run = 0; run < 3; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::max(best, n / elapsed.count() / 1e9);
+    }
+    return best;
+}
+
+void benchmark(size_t mib) {
+    const auto n = mib << 20;
+    byte_vector data(n), key(n);
+    fill_random(data);
+    const auto copy = data;
+    std::cout << "payload: " << mib << " MiB\n" << std::fixed << std::setprecision(2);
+    std::cout << "getrandom      " << throughput(n, [&]() { fill_random(key); }) << " GB/s\n";
+    std::cout << "xor per byte   " << throughput(n, [&]() {
+            for (size_t i = 0; i < n; ++i) data[i] ^= key[i];
+            }) << " GB/s\n";
+    std::cout << "xor scalar     " << throughput(n, [&]() {
+            otp_detail::xor_scalar(data.data(), data.data(), key.data(), n);
+            }) << " GB/s\n";
+#if HAVE_X86_KERNELS
+    std::cout << "xor sse2       " << throughput(n, [&]() {
+            otp_detail::xor_sse2(data.data(), data.data(), key.data(), n);
+            }) << " GB/s\n";
+    if (cpu_has_avx2()) {
+        std::cout << "xor avx2       " << throughput(n, [&]() {
+                otp_detail::xor_avx2(data.data(), data.data(), key.data(), n);
+                }) << " GB/s\n";
+    }
+#endif
+    std::cout << "encrypt        " << throughput(n, [&]() { encrypt_in_place(data, key); }) << " GB/s\n";
+
+    data = copy;
+    encrypt_in_place(data, key);
+    bool ok = true;
+    for (size_t i = 0; i < n; ++i) ok &= data[i] == (copy[i] ^ key[i]);
+    decrypt_in_place(data, key);
+    std::cout << (ok && data == copy ? "round trip ok" : "round trip FAILED") << '\n';
 }
 
 int main(int argc, char* argv[]) {
-    const std::string textToEncrypt = argc == 1 ? "One Time Pad" : argv[1];
+    bool bench = false;
+    char mode = 0;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    int c;
+    while ((c = getopt(argc, argv, "bedj:")) != -1) {
+        switch (c) {
+            case 'b': bench = true; break;
+            case 'e': case 'd': mode = c; break;
+            case 'j': threads = std::max(1, std::stoi(optarg)); break;
+            default: return 1;
+        }
+    }
+    if (mode) {
+        if (argc - optind != 3) {
+            std::cerr << "usage: " << argv[0] << " [-j threads] -e input key cipher\n"
+                      << "       " << argv[0] << " -d cipher key output\n";
+            return 1;
+        }
+        try {
+            if (mode == 'e') encrypt_file(argv[optind], argv[optind + 1], argv[optind + 2], threads);
+            else decrypt_file(argv[optind], argv[optind + 1], argv[optind + 2]);
+        } catch (const std::exception& e) {
+            std::cerr << argv[0] << ": " << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    if (bench) {
+        benchmark(optind < argc ? std::stoul(argv[optind]) : 256);
+        return 0;
+    }
+
+    const std::string textToEncrypt = optind == argc ? "One Time Pad" : argv[optind];
 
     key_pair keyPair = encrypt(textToEncrypt);
 
     std::cout << decrypt(keyPair) << std::endl;
-}
\ No newline at end of file
+}
@@ -1,77 +1,410 @@
 #ifndef BFS_H
 #define BFS_H
 
-#include <cassert>
-#include <deque>
-#include <iostream>
-#include <queue>
+#include "dary_heap.h"
+#include "flat_hash_set.h"
+#include "node_arena.h"
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
 #include <set>
-#include <tuple>
+#include <thread>
+#include <utility>
 #include <vector>
 
 template <typename State>
-struct Node {
-    State state;
-    const Node* parent;
-};
+using Path = std::vector<State>;
 
 template <typename State>
-bool operator<(const Node<State>& lhs, const Node<State>& rhs) {
-    return lhs.state < rhs.state;
-}
+using GoalTestFn = std::function<bool(const State&)>;
 
 template <typename State>
-bool operator==(const Node<State>& lhs, const Node<State>& rhs) {
-    return lhs.state == rhs.state;
-}
+using SuccessorsFn = std::function<std::vector<State>(const State&)>;
 
+// Breadth-first search. Nodes are appended to an arena in the order they
+// are generated, so the arena is also the queue: the frontier is every
+// node from head on. States are marked explored when generated, so each
+// is queued once.
 template <typename State>
-std::ostream& operator<<(std::ostream& os, const Node<State>& n) {
-    return os << '{' << n.state << ',' << n.parent << '}';
+Path<State> bfs(
+        const State& initial_state,
+        GoalTestFn<State> goal_test,
+        SuccessorsFn<State> successors)
+{
+    NodeArena<State> nodes;
+    std::set<State> explored{initial_state};
+    nodes.push(initial_state);
+    for (uint32_t head = 0; head < nodes.size(); ++head) {
+        if (goal_test(nodes[head].state)) {
+            return build_path(nodes, head);
+        }
+        for (const auto& s : successors(nodes[head].state)) {
+            if (explored.insert(s).second) nodes.push(s, head);
+        }
+    }
+    return {};
+}
+
+// Same search with the goal test and successors called directly, so they
+// can be inlined, and explored states kept in a hash set keyed by hash.
+template <typename State, typename GoalTest, typename Successors, typename Hash>
+Path<State> bfs(
+        const State& initial_state,
+        GoalTest goal_test,
+        Successors successors,
+        Hash hash)
+{
+    NodeArena<State> nodes;
+    FlatHashSet<State, Hash> explored{1024, hash};
+    explored.insert(initial_state);
+    nodes.push(initial_state);
+    for (uint32_t head = 0; head < nodes.size(); ++head) {
+        if (goal_test(nodes[head].state)) {
+            return build_path(nodes, head);
+        }
+        for (const auto& s : successors(nodes[head].state)) {
+            if (explored.insert(s)) nodes.push(s, head);
+        }
+    }
+    return {};
 }
 
 template <typename State>
-using Path = std::vector<State>;
+struct SearchResult {
+    Path<State> path;
+    double cost = 0;
+    size_t expanded = 0;
+};
 
+// Successors for a_star() yield either a bare state, one step away, or a
+// (state, step cost) pair.
+template <typename State>
+const State& edge_target(const State& s) { return s; }
 template <typename State>
-Path<State> build_path(const Node<State>* n) {
-    assert(n);
-    Path<State> tmp;
-    while (n) {
-        tmp.push_back(n->state);
-        n = n->parent;
+double edge_cost(const State&) { return 1.0; }
+template <typename State, typename Cost>
+const State& edge_target(const std::pair<State, Cost>& e) { return e.first; }
+template <typename State, typename Cost>
+double edge_cost(const std::pair<State, Cost>& e) { return e.second; }
+
+// A* search. heuristic(state) must never overestimate the remaining cost;
+// index(state) numbers the states densely in [0, state_count), so g-scores
+// and the closed set are flat arrays instead of maps. The frontier is a
+// 4-ary heap with no decrease-key: a state whose cost drops is pushed
+// again and the outdated entry is skipped when it surfaces. Ties on f go to
+// the deeper entry, which is nearer the goal.
+template <typename State, typename GoalTest, typename Successors, typename Heuristic, typename Index>
+SearchResult<State> a_star(
+        const State& initial_state,
+        GoalTest goal_test,
+        Successors successors,
+        Heuristic heuristic,
+        Index index,
+        size_t state_count)
+{
+    struct Entry {
+        double f, g;
+        uint32_t node;
+    };
+    auto less = [](const Entry& lhs, const Entry& rhs) {
+        return lhs.f < rhs.f || (lhs.f == rhs.f && lhs.g > rhs.g);
+    };
+    NodeArena<State> nodes;
+    DaryHeap<Entry, decltype(less)> frontier{less};
+    std::vector<double> g_score(state_count, std::numeric_limits<double>::infinity());
+    std::vector<bool> closed(state_count);
+    SearchResult<State> result;
+    g_score[index(initial_state)] = 0;
+    frontier.push({heuristic(initial_state), 0, nodes.push(initial_state)});
+    while (!frontier.empty()) {
+        const auto current = frontier.top();
+        frontier.pop();
+        const auto& state = nodes[current.node].state;
+        const auto i = index(state);
+        if (closed[i] || current.g > g_score[i]) continue;
+        closed[i] = true;
+        if (goal_test(state)) {
+            result.path = build_path(nodes, current.node);
+            result.cost = current.g;
+            return result;
+        }
+        ++result.expanded;
+        for (const auto& e : successors(state)) {
+            const auto& s = edge_target<State>(e);
+            const auto j = index(s);
+            const auto g = current.g + edge_cost<State>(e);
+            if (g < g_score[j]) {
+                g_score[j] = g;
+                frontier.push({g + heuristic(s), g, nodes.push(s, current.node)});
+            }
+        }
     }
-    return {tmp.rbegin(), tmp.rend()};
+    return result;
 }
 
-template <typename State>
-using GoalTestFn = std::function<bool(const State&)>;
+namespace bfs_detail {
 
-template <typename State>
-using SuccessorsFn = std::function<std::vector<State>(const State&)>;
+// Node numbers of states numbered densely by index in [0, state_count),
+// kept in a flat array; a drop-in for FlatHashMap<State, uint32_t>.
+template <typename State, typename Index>
+class IndexedNodeMap {
+public:
+    IndexedNodeMap(Index index, size_t state_count) : index_(index), nodes_(state_count, NodeArena<State>::none) {}
 
-template <typename State>
-Path<State> bfs(
+    std::pair<uint32_t*, bool> try_emplace(const State& state, uint32_t node) {
+        auto& n = nodes_[index_(state)];
+        const auto inserted = n == NodeArena<State>::none;
+        if (inserted) n = node;
+        return {&n, inserted};
+    }
+
+    const uint32_t* find(const State& state) const {
+        const auto& n = nodes_[index_(state)];
+        return n == NodeArena<State>::none ? nullptr : &n;
+    }
+
+private:
+    Index index_;
+    std::vector<uint32_t> nodes_;
+};
+
+// The search behind both bidirectional_bfs() overloads. Seen maps a state
+// to its node on one side. Nodes are numbered in the order their side
+// reaches them, so the lowest node number met on the other side is also
+// the shallowest.
+template <typename State, typename Successors, typename Predecessors, typename Seen>
+SearchResult<State> bidirectional_bfs(
         const State& initial_state,
-        GoalTestFn<State> goal_test,
-        SuccessorsFn<State> successors)
+        const State& goal,
+        Successors successors,
+        Predecessors predecessors,
+        Seen forward_seen,
+        Seen backward_seen)
 {
-    std::deque<Node<State>> frontier{{initial_state}};
-    std::set<Node<State>> explored;
-    do {
-        const auto& current_node = frontier.front();
-        const auto& current_state = current_node.state;
-        if (goal_test(current_state)) {
-            return build_path(&current_node);
+    struct Side {
+        NodeArena<State> nodes;
+        Seen seen;
+        std::vector<uint32_t> frontier, next;
+    };
+    SearchResult<State> result;
+    if (initial_state == goal) {
+        result.path = {initial_state};
+        return result;
+    }
+    Side forward{{}, std::move(forward_seen), {}, {}}, backward{{}, std::move(backward_seen), {}, {}};
+    for (auto [side, root] : {std::pair{&forward, initial_state}, std::pair{&backward, goal}}) {
+        side->seen.try_emplace(root, side->nodes.push(root));
+        side->frontier.push_back(0);
+    }
+    // Expands one level of `from`; returns the best meeting point as
+    // (node in from, node in other), or none.
+    auto expand = [&result](Side& from, const Seen& other, auto& neighbours) {
+        uint32_t from_node = 0, other_node = NodeArena<State>::none;
+        from.next.clear();
+        for (const auto current : from.frontier) {
+            ++result.expanded;
+            for (const auto& s : neighbours(from.nodes[current].state)) {
+                if (!from.seen.try_emplace(s, from.nodes.size()).second) continue;
+                const auto n = from.nodes.push(s, current);
+                from.next.push_back(n);
+                if (const auto meet = other.find(s); meet && *meet < other_node) {
+                    from_node = n;
+                    other_node = *meet;
+                }
+            }
         }
-        const auto [it, _] = explored.insert(current_node);
-        for (const auto& s : successors(current_state)) {
-            Node<State> n{s, &*it};
-            if (explored.find(n) == explored.end()) frontier.push_back(n);
+        std::swap(from.frontier, from.next);
+        return other_node == NodeArena<State>::none ? std::optional<std::pair<uint32_t, uint32_t>>{}
+                                                    : std::pair{from_node, other_node};
+    };
+    while (!forward.frontier.empty() && !backward.frontier.empty()) {
+        const auto forward_turn = forward.frontier.size() <= backward.frontier.size();
+        const auto meet = forward_turn ? expand(forward, backward.seen, successors)
+                                       : expand(backward, forward.seen, predecessors);
+        if (!meet) continue;
+        const auto [f, b] = forward_turn ? *meet : std::pair{meet->second, meet->first};
+        // f and b are the same state; the backward chain runs from it to goal.
+        result.path = build_path(forward.nodes, f);
+        for (auto i = backward.nodes[b].parent; i != NodeArena<State>::none; i = backward.nodes[i].parent) {
+            result.path.push_back(backward.nodes[i].state);
         }
-        frontier.pop_front();
-    } while (!frontier.empty());
-    return {};
+        result.cost = result.path.size() - 1;
+        return result;
+    }
+    return result;
+}
+
+} // namespace bfs_detail
+
+// Breadth-first search from both ends at once: forward from initial_state
+// along successors and backward from goal along predecessors (the same
+// function when moves are reversible). Each round expands one whole level
+// of the smaller frontier and stops at the shortest connection found in
+// it, so about 2 b^(d/2) states are expanded instead of b^d.
+template <typename State, typename Successors, typename Predecessors, typename Hash>
+SearchResult<State> bidirectional_bfs(
+        const State& initial_state,
+        const State& goal,
+        Successors successors,
+        Predecessors predecessors,
+        Hash hash)
+{
+    using Seen = FlatHashMap<State, uint32_t, Hash>;
+    return bfs_detail::bidirectional_bfs(initial_state, goal, successors, predecessors, Seen{1024, hash}, Seen{1024, hash});
+}
+
+// Same search with states numbered densely by index(state) in
+// [0, state_count), as for a_star(), so each side finds its states in a
+// flat array of 4 bytes per state instead of a hash map.
+template <typename State, typename Successors, typename Predecessors, typename Index>
+SearchResult<State> bidirectional_bfs(
+        const State& initial_state,
+        const State& goal,
+        Successors successors,
+        Predecessors predecessors,
+        Index index,
+        size_t state_count)
+{
+    using Seen = bfs_detail::IndexedNodeMap<State, Index>;
+    return bfs_detail::bidirectional_bfs(initial_state, goal, successors, predecessors,
+                                         Seen{index, state_count}, Seen{index, state_count});
+}
+
+// Level-synchronous breadth-first search on several threads. Each level's
+// frontier is handed out in blocks, and each block's new states are
+// collected with their parents in a buffer of its own. A state reached from
+// several parents belongs to the one that comes first in the frontier, or
+// the earlier of its moves from that parent: the visited map keeps the
+// lowest (parent index, move) seen. Between levels one thread appends the
+// block buffers in order to the node arena, keeping only those claims,
+// which becomes the next frontier. So the arena holds the states in the
+// order a sequential breadth-first search would, whatever the thread
+// timing, parent indices always point at nodes that exist, and the goal
+// with the lowest index is the same on every run. goal_test and successors
+// are called concurrently and must not modify shared state; a goal_test
+// that never succeeds explores every reachable state, and result.expanded
+// tells how many there were.
+template <typename State, typename GoalTest, typename Successors, typename Hash>
+SearchResult<State> parallel_bfs(
+        const State& initial_state,
+        GoalTest goal_test,
+        Successors successors,
+        Hash hash,
+        unsigned threads)
+{
+    constexpr uint32_t block = 256;
+    threads = std::max(threads, 1u);
+    NodeArena<State> nodes;
+    // Who claimed a state: parent index in the high half, the number of
+    // the move from it in the low half.
+    auto claim = [](uint32_t parent, uint32_t move) { return uint64_t{parent} << 32 | move; };
+    ShardedHashMap<State, uint64_t, Hash> visited{8, hash};
+    visited.insert_or_lower(initial_state, 0);
+    uint32_t level_begin = 0, level_end = nodes.push(initial_state) + 1;
+    std::atomic<uint32_t> next{0}, found{NodeArena<State>::none};
+    // One buffer per block of the level being expanded.
+    struct Discovered {
+        State state;
+        uint32_t parent, move;
+    };
+    std::vector<std::vector<Discovered>> discovered;
+    bool done = false;
+    SearchResult<State> result;
+    // The first exception from a worker or from end_level(), which must not
+    // throw; it ends the search at the next barrier and is rethrown after
+    // the joins.
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::atomic<bool> failed{false};
+    auto fail = [&]() noexcept {
+        const std::lock_guard lock{error_mutex};
+        if (!error) error = std::current_exception();
+        failed = true;
+    };
+    auto end_level = [&]() noexcept {
+        try {
+            result.expanded += level_end - level_begin;
+            for (auto& d : discovered) {
+                for (const auto& [s, parent, move] : d) {
+                    if (*visited.find(s) == claim(parent, move)) nodes.push(s, parent);
+                }
+                d.clear();
+            }
+            level_begin = level_end;
+            level_end = nodes.size();
+            discovered.resize(std::max<size_t>(discovered.size(), (level_end - level_begin + block - 1) / block));
+            next = level_begin;
+        } catch (...) {
+            fail();
+        }
+        done = failed || found != NodeArena<State>::none || level_begin == level_end;
+    };
+    discovered.resize(1);
+    std::barrier sync{static_cast<std::ptrdiff_t>(threads), end_level};
+    auto work = [&]() {
+        while (!done) {
+            try {
+                for (uint32_t first; (first = next.fetch_add(block)) < level_end;) {
+                    auto& out = discovered[(first - level_begin) / block];
+                    for (auto i = first; i < std::min(first + block, level_end); ++i) {
+                        const auto& state = nodes[i].state;
+                        if (goal_test(state)) {
+                            auto seen = found.load();
+                            while (i < seen && !found.compare_exchange_weak(seen, i)) {}
+                        }
+                        uint32_t move = 0;
+                        for (const auto& s : successors(state)) {
+                            if (visited.insert_or_lower(s, claim(i, move))) out.push_back({s, i, move});
+                            ++move;
+                        }
+                    }
+                }
+            } catch (...) {
+                // Hand out no more blocks, but keep arriving at the barrier
+                // so the other threads are not left waiting.
+                fail();
+                next = level_end;
+            }
+            sync.arrive_and_wait();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    if (error) std::rethrow_exception(error);
+    if (found != NodeArena<State>::none) {
+        result.path = build_path(nodes, found);
+        result.cost = result.path.size() - 1;
+    }
+    return result;
+}
+
+// Admissible distance estimates for grid states with row and col members:
+// Manhattan for 4-connected moves, octile for 8-connected moves where a
+// diagonal step costs sqrt(2), and Euclidean for either.
+template <typename Location>
+double manhattan_distance(const Location& a, const Location& b) {
+    return std::abs(a.row - b.row) + std::abs(a.col - b.col);
+}
+
+template <typename Location>
+double euclidean_distance(const Location& a, const Location& b) {
+    return std::hypot(a.row - b.row, a.col - b.col);
+}
+
+template <typename Location>
+double octile_distance(const Location& a, const Location& b) {
+    const auto dr = std::abs(a.row - b.row), dc = std::abs(a.col - b.col);
+    return std::max(dr, dc) + (std::sqrt(2.0) - 1) * std::min(dr, dc);
 }
 
 #endif
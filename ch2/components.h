@@ -0,0 +1,184 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include "grid.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// The connected regions of open cells in a Grid, as one label per cell:
+// two cells are connected exactly when their labels are equal. Moves are
+// 4-connected, which also covers 8-connected moves that may not cut
+// corners, since such a diagonal step can always be replaced by two
+// orthogonal ones.
+//
+// Labels come from a union-find over the grid in three passes. The rows
+// are split into bands, one per thread; each band points every open cell
+// at the first cell of its run and joins runs that touch across rows.
+// Then one thread joins the bands across their seams. Finally each band
+// points its cells straight at their roots. A label is the index of its
+// region's root cell, so labels are not consecutive. The passes over the
+// whole grid are memory bound, so there are only two of them.
+class ComponentIndex {
+public:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    ComponentIndex() = default;
+    explicit ComponentIndex(const Grid& m, unsigned threads = 1) { build(m, threads); }
+
+    // (Re)labels m, reusing the label array when the size is unchanged.
+    void build(const Grid& m, unsigned threads = 1) {
+        if (m.size() >= none) throw std::length_error("grid too large to label");
+        threads = std::clamp(threads, 1u, static_cast<unsigned>(std::max(m.rows(), 1)));
+        if (m.size() != size_) {
+            parent_ = std::make_unique_for_overwrite<uint32_t[]>(m.size());
+            size_ = m.size();
+        }
+        stride_ = m.stride();
+        std::fill_n(&parent_[0], stride_, none);
+        std::fill_n(&parent_[size_ - stride_], stride_, none);
+        std::vector<int> bands(threads + 1);
+        for (unsigned t = 0; t <= threads; ++t) bands[t] = static_cast<int>(uint64_t{t} * m.rows() / threads);
+        std::vector<size_t> counts(threads);
+        run(threads, [&](unsigned t) { label_band(m, bands[t], bands[t + 1]); });
+        std::vector<uint32_t> linked;
+        for (unsigned t = 1; t < threads; ++t) {
+            join_rows(m, bands[t], [&](uint32_t a, uint32_t b) {
+                a = find(a), b = find(b);
+                if (a == b) return;
+                if (a < b) std::swap(a, b);
+                parent_[a] = b;
+                linked.push_back(a);
+            });
+        }
+        for (const auto a : linked) parent_[a] = find(a);
+        run(threads, [&](unsigned t) { counts[t] = flatten(m, bands[t], bands[t + 1]); });
+        count_ = 0;
+        for (const auto n : counts) count_ += n;
+    }
+
+    uint32_t label(const Location& l) const { return parent_[(l.row + 1) * stride_ + (l.col + 1)]; }
+
+    // Starts loading the label of l into the cache.
+    void prefetch(const Location& l) const { __builtin_prefetch(&parent_[(l.row + 1) * stride_ + (l.col + 1)]); }
+
+    // Whether b can be reached from a; a blocked cell reaches nothing.
+    bool connected(const Location& a, const Location& b) const {
+        const auto la = label(a);
+        return la != none && la == label(b);
+    }
+
+    // Number of regions.
+    size_t count() const { return count_; }
+
+private:
+    size_t stride_ = 0, size_ = 0;
+    std::unique_ptr<uint32_t[]> parent_;
+    size_t count_ = 0;
+
+    template <typename F>
+    static void run(unsigned threads, F work) {
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work, t);
+        work(0);
+        for (auto& t : pool) t.join();
+    }
+
+    // Root of i, halving the path on the way.
+    uint32_t find(uint32_t i) {
+        while (parent_[i] != i) {
+            parent_[i] = parent_[parent_[i]];
+            i = parent_[i];
+        }
+        return i;
+    }
+
+    // Calls join(cell, cell above) once for each stretch of row r that is
+    // open in both r and the row above.
+    template <typename Join>
+    void join_rows(const Grid& m, int r, Join join) const {
+        const auto& blocked = m.blocked();
+        const std::ptrdiff_t first = m.index({r, 0});
+        const std::ptrdiff_t above = first - static_cast<std::ptrdiff_t>(stride_);
+        for (std::ptrdiff_t p = 0; p < m.cols(); p += 64) {
+            // A cell left of the row is blocked, so a stretch never
+            // continues from before the first cell.
+            const auto both = ~(blocked.window(first + p) | blocked.window(above + p));
+            const auto before = ~(blocked.window(first + p - 1) | blocked.window(above + p - 1));
+            auto starts = both & ~before;
+            if (m.cols() - p < 64) starts &= (uint64_t{1} << (m.cols() - p)) - 1;
+            for (; starts; starts &= starts - 1) {
+                const auto i = static_cast<uint32_t>(first + p + std::countr_zero(starts));
+                join(i, i - static_cast<uint32_t>(stride_));
+            }
+        }
+    }
+
+    // Rows [first, last), border columns included: each open cell points
+    // at the first cell of its run, and runs touching across rows of the
+    // band are joined. Then the run starts are pointed at the band's
+    // roots. Touches only cells of the band.
+    void label_band(const Grid& m, int first, int last) {
+        std::vector<uint32_t> starts;
+        size_t count = 0;
+        for (int r = first; r < last; ++r) {
+            const auto row = static_cast<uint32_t>(m.index({r, -1}));
+            if (starts.size() < count + stride_) starts.resize(2 * (count + stride_));
+            // Branch-free: on a random maze whether a cell is open is a
+            // coin toss the branch predictor keeps losing.
+            uint32_t run = none;
+            bool was_open = false;
+            for (size_t w = 0; w < stride_; w += 64) {
+                const auto open = ~m.blocked().window(row + w);
+                const auto n = std::min<size_t>(64, stride_ - w);
+                for (size_t j = 0; j < n; ++j) {
+                    const auto i = static_cast<uint32_t>(row + w + j);
+                    const bool is_open = open >> j & 1;
+                    const bool start = is_open && !was_open;
+                    run = start ? i : run;
+                    starts[count] = i;
+                    count += start;
+                    parent_[i] = is_open ? run : none;
+                    was_open = is_open;
+                }
+            }
+            if (r == first) continue;
+            join_rows(m, r, [this](uint32_t a, uint32_t b) {
+                a = find(a), b = find(b);
+                if (a != b) parent_[std::max(a, b)] = std::min(a, b);
+            });
+        }
+        for (size_t k = 0; k < count; ++k) parent_[starts[k]] = find(starts[k]);
+    }
+
+    // Points the cells of rows [first, last) at their final roots and
+    // returns how many roots the band holds. A cell points at the start of
+    // its run, which, earlier in the row, already points at the final
+    // root; a run start points at a root, whose parent is final once the
+    // seams are joined. Final roots are read by other bands while their
+    // own band rewrites them with the same value, so the accesses are
+    // relaxed atomics; on x86 they are plain moves, and the loop stays
+    // branch-free.
+    size_t flatten(const Grid& m, int first, int last) {
+        size_t roots = 0;
+        const auto begin = static_cast<uint32_t>(m.index({first, 0}));
+        const auto end = static_cast<uint32_t>(m.index({last, 0}));
+        auto at = [this](uint32_t i) { return std::atomic_ref<uint32_t>{parent_[i]}; };
+        for (auto i = begin; i < end; ++i) {
+            const auto p = at(i).load(std::memory_order_relaxed);
+            const auto open = p != none;
+            const auto q = at(open ? p : i).load(std::memory_order_relaxed);
+            at(i).store(open ? q : none, std::memory_order_relaxed);
+            roots += p == i;
+        }
+        return roots;
+    }
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef DARY_HEAP_H
+#define DARY_HEAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Implicit d-ary min-heap. A wider node than the binary heap's makes the
+// tree shallower, so pushes, which dominate in search, touch fewer levels,
+// and the children compared on a pop sit in one or two cache lines.
+template <typename T, typename Compare = std::less<T>, size_t D = 4>
+class DaryHeap {
+public:
+    explicit DaryHeap(Compare less = {}) : less_(less) {}
+
+    bool empty() const { return items_.empty(); }
+    size_t size() const { return items_.size(); }
+    const T& top() const { return items_.front(); }
+
+    void clear() { items_.clear(); }
+    void reserve(size_t n) { items_.reserve(n); }
+
+    void push(T item) {
+        auto i = items_.size();
+        items_.push_back(std::move(item));
+        while (i > 0) {
+            const auto parent = (i - 1) / D;
+            if (!less_(items_[i], items_[parent])) break;
+            std::swap(items_[i], items_[parent]);
+            i = parent;
+        }
+    }
+
+    void pop() {
+        assert(!items_.empty());
+        items_.front() = std::move(items_.back());
+        items_.pop_back();
+        const auto n = items_.size();
+        size_t i = 0;
+        while (true) {
+            const auto first = D * i + 1;
+            if (first >= n) break;
+            auto best = first;
+            for (auto c = first + 1; c < std::min(first + D, n); ++c) {
+                if (less_(items_[c], items_[best])) best = c;
+            }
+            if (!less_(items_[best], items_[i])) break;
+            std::swap(items_[i], items_[best]);
+            i = best;
+        }
+    }
+
+private:
+    std::vector<T> items_;
+    Compare less_;
+};
+
+#endif
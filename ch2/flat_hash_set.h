@@ -0,0 +1,190 @@
+#ifndef FLAT_HASH_SET_H
+#define FLAT_HASH_SET_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// 64-bit finalizer that spreads a weak user hash over all bits.
+inline uint64_t hash_mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+}
+
+namespace flat_hash_detail {
+
+// Open addressing with linear probing, all entries in one array; the
+// table behind FlatHashSet and FlatHashMap. key_of(entry) is the key an
+// entry is stored under.
+template <typename Key, typename Entry, typename KeyOf, typename Hash, typename KeyEqual>
+class Table {
+public:
+    Table(size_t expected, Hash hash, KeyEqual equal)
+        : slots_(std::bit_ceil(std::max<size_t>(2 * expected, 16))), hash_(hash), equal_(equal) {}
+
+    // The slot holding key, or the empty slot where it would go.
+    size_t slot_index(const Key& key) const {
+        const auto mask = slots_.size() - 1;
+        for (auto i = hash_mix(hash_(key)) & mask;; i = (i + 1) & mask) {
+            if (!slots_[i] || equal_(KeyOf{}(*slots_[i]), key)) return i;
+        }
+    }
+
+    std::optional<Entry>& operator[](size_t i) { return slots_[i]; }
+    const std::optional<Entry>& operator[](size_t i) const { return slots_[i]; }
+
+    // Counts an entry just placed in an empty slot. Returns true if the
+    // table grew, which moves every entry.
+    bool added() {
+        if (++size_ * 2 <= slots_.size()) return false;
+        auto old = std::exchange(slots_, std::vector<std::optional<Entry>>(2 * slots_.size()));
+        for (auto& slot : old) {
+            if (slot) slots_[slot_index(KeyOf{}(*slot))].emplace(std::move(*slot));
+        }
+        return true;
+    }
+
+    size_t size() const { return size_; }
+
+    void clear() {
+        for (auto& slot : slots_) slot.reset();
+        size_ = 0;
+    }
+
+private:
+    std::vector<std::optional<Entry>> slots_;
+    size_t size_ = 0;
+    Hash hash_;
+    KeyEqual equal_;
+};
+
+struct Self {
+    template <typename T>
+    const T& operator()(const T& x) const { return x; }
+};
+
+struct First {
+    template <typename T>
+    const auto& operator()(const T& x) const { return x.first; }
+};
+
+} // namespace flat_hash_detail
+
+// Open addressing hash set with linear probing, all keys in one array.
+// Hash is supplied by the user and need not be well mixed: its result goes
+// through a 64-bit finalizer before picking a slot. Keys are only ever
+// copy constructed, never assigned, so states with const members work.
+template <typename Key, typename Hash, typename KeyEqual = std::equal_to<Key>>
+class FlatHashSet {
+public:
+    explicit FlatHashSet(size_t expected = 16, Hash hash = {}, KeyEqual equal = {})
+        : table_(expected, hash, equal) {}
+
+    // Returns false if key was already present.
+    bool insert(const Key& key) {
+        auto& slot = table_[table_.slot_index(key)];
+        if (slot) return false;
+        slot.emplace(key);
+        table_.added();
+        return true;
+    }
+
+    bool contains(const Key& key) const {
+        return table_[table_.slot_index(key)].has_value();
+    }
+
+    size_t size() const { return table_.size(); }
+    void clear() { table_.clear(); }
+
+private:
+    flat_hash_detail::Table<Key, Key, flat_hash_detail::Self, Hash, KeyEqual> table_;
+};
+
+// The same table with a value per key.
+template <typename Key, typename Value, typename Hash, typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap {
+public:
+    explicit FlatHashMap(size_t expected = 16, Hash hash = {}, KeyEqual equal = {})
+        : table_(expected, hash, equal) {}
+
+    // Inserts (key, value) unless key is present. Returns the stored value
+    // and whether it was inserted; the pointer is valid until the next
+    // insertion.
+    std::pair<Value*, bool> try_emplace(const Key& key, const Value& value) {
+        auto i = table_.slot_index(key);
+        if (table_[i]) return {&table_[i]->second, false};
+        table_[i].emplace(key, value);
+        if (table_.added()) i = table_.slot_index(key);
+        return {&table_[i]->second, true};
+    }
+
+    const Value* find(const Key& key) const {
+        const auto& slot = table_[table_.slot_index(key)];
+        return slot ? &slot->second : nullptr;
+    }
+
+    size_t size() const { return table_.size(); }
+    void clear() { table_.clear(); }
+
+private:
+    flat_hash_detail::Table<Key, std::pair<Key, Value>, flat_hash_detail::First, Hash, KeyEqual> table_;
+};
+
+// A FlatHashMap split into independently locked shards picked by the top
+// bits of the mixed hash, so threads inserting at once rarely wait on the
+// same lock.
+template <typename Key, typename Value, typename Hash, typename KeyEqual = std::equal_to<Key>>
+class ShardedHashMap {
+public:
+    explicit ShardedHashMap(unsigned shard_bits = 6, Hash hash = {}, KeyEqual equal = {})
+        : shard_bits_(shard_bits), hash_(hash) {
+        shards_.reserve(size_t{1} << shard_bits);
+        for (size_t i = 0; i < (size_t{1} << shard_bits); ++i) shards_.push_back(std::make_unique<Shard>(hash, equal));
+    }
+
+    // Stores value under key unless a value no greater is stored there
+    // already; returns whether it was stored. Safe to call concurrently.
+    bool insert_or_lower(const Key& key, const Value& value) {
+        auto& shard = shard_for(key);
+        std::lock_guard lock{shard.mutex};
+        const auto [stored, inserted] = shard.entries.try_emplace(key, value);
+        if (inserted) return true;
+        if (!(value < *stored)) return false;
+        *stored = value;
+        return true;
+    }
+
+    // Not safe while another thread inserts.
+    const Value* find(const Key& key) const { return shard_for(key).entries.find(key); }
+
+    size_t size() const {
+        size_t n = 0;
+        for (const auto& shard : shards_) n += shard->entries.size();
+        return n;
+    }
+
+private:
+    struct alignas(64) Shard {
+        Shard(Hash hash, KeyEqual equal) : entries{16, hash, equal} {}
+        std::mutex mutex;
+        FlatHashMap<Key, Value, Hash, KeyEqual> entries;
+    };
+
+    unsigned shard_bits_;
+    Hash hash_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    Shard& shard_for(const Key& key) const { return *shards_[hash_mix(hash_(key)) >> (64 - shard_bits_)]; }
+};
+
+#endif
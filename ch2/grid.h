@@ -0,0 +1,320 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+enum class Cell: char {
+    Empty = ' ',
+    Blocked = '#',
+    Start = 'S',
+    Goal = 'G',
+    Path = '.',
+};
+
+inline std::ostream& operator<<(std::ostream& os, Cell c) {
+    return os << static_cast<char>(c);
+}
+
+struct Location { int row, col; };
+
+inline bool operator==(const Location& lhs, const Location& rhs) {
+    return lhs.row == rhs.row && lhs.col == rhs.col;
+}
+
+inline bool operator<(const Location& lhs, const Location& rhs) {
+    return lhs.row < rhs.row || (lhs.row == rhs.row && lhs.col < rhs.col);
+}
+
+struct LocationHash {
+    size_t operator()(const Location& l) const {
+        return static_cast<size_t>(static_cast<uint32_t>(l.row)) << 32 | static_cast<uint32_t>(l.col);
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Location& l) {
+    return os << '{' << l.row << ',' << l.col << '}';
+}
+
+// One bit per grid cell, addressed by Grid::index(). The words are either
+// owned or borrowed from someone else, such as a mapped file.
+class CellBitset {
+public:
+    explicit CellBitset(size_t n = 0) : owned_((n + 63) / 64), words_(owned_.data()), count_(owned_.size()) {}
+    CellBitset(uint64_t* words, size_t count) : words_(words), count_(count) {}
+
+    CellBitset(const CellBitset& other)
+        : owned_(other.owned_), words_(owned_.empty() ? other.words_ : owned_.data()), count_(other.count_) {}
+    CellBitset(CellBitset&& other) noexcept = default;
+    CellBitset& operator=(CellBitset other) noexcept {
+        std::swap(owned_, other.owned_);
+        std::swap(words_, other.words_);
+        std::swap(count_, other.count_);
+        return *this;
+    }
+
+    bool test(size_t i) const { return words_[i >> 6] >> (i & 63) & 1; }
+    void set(size_t i) { words_[i >> 6] |= uint64_t{1} << (i & 63); }
+    void reset(size_t i) { words_[i >> 6] &= ~(uint64_t{1} << (i & 63)); }
+
+    // Sets bit i; returns false if it was set already.
+    bool insert(size_t i) {
+        auto& word = words_[i >> 6];
+        const auto bit = uint64_t{1} << (i & 63);
+        if (word & bit) return false;
+        word |= bit;
+        return true;
+    }
+
+    // Bits first .. first + 63 as one word, bit 0 first. Bits outside the
+    // set read as 0.
+    uint64_t window(std::ptrdiff_t first) const {
+        const auto word = first >> 6;
+        const auto shift = first & 63;
+        const auto low = word_at(word);
+        return shift == 0 ? low : low >> shift | word_at(word + 1) << (64 - shift);
+    }
+
+    const uint64_t* words() const { return words_; }
+    size_t word_count() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+private:
+    std::vector<uint64_t> owned_;
+    uint64_t* words_;
+    size_t count_;
+
+    uint64_t word_at(std::ptrdiff_t w) const {
+        return 0 <= w && static_cast<size_t>(w) < count_ ? words_[w] : 0;
+    }
+};
+
+// Moves in the order successors are generated: the four orthogonal ones
+// clockwise from up, then all eight row by row for 8-connected moves.
+inline constexpr std::array<Location, 4> orthogonal_moves{{{-1, 0}, {0, 1}, {1, 0}, {0, -1}}};
+inline constexpr std::array<Location, 8> king_moves{{
+    {-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1},
+}};
+
+// The open neighbours of a cell as a range. Which moves are open is worked
+// out once, as a bit mask, when the range is made; iterating only walks
+// the set bits, so nothing is allocated. With diagonal moves the range
+// yields (location, step cost) pairs, as a_star() accepts.
+template <bool diagonal>
+class NeighborRange {
+public:
+    using value_type = std::conditional_t<diagonal, std::pair<Location, double>, Location>;
+
+    NeighborRange() = default;
+    NeighborRange(Location center, unsigned mask) : center_(center), mask_(mask) {}
+
+    class iterator {
+    public:
+        using value_type = NeighborRange::value_type;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        iterator(Location center, unsigned mask) : center_(center), mask_(mask) {}
+
+        value_type operator*() const {
+            const auto k = std::countr_zero(mask_);
+            if constexpr (diagonal) {
+                const auto [dr, dc] = king_moves[k];
+                return {{center_.row + dr, center_.col + dc}, dr && dc ? std::sqrt(2.0) : 1.0};
+            } else {
+                const auto [dr, dc] = orthogonal_moves[k];
+                return {center_.row + dr, center_.col + dc};
+            }
+        }
+        iterator& operator++() { mask_ &= mask_ - 1; return *this; }
+        iterator operator++(int) { auto old = *this; ++*this; return old; }
+        bool operator==(const iterator& rhs) const { return mask_ == rhs.mask_; }
+
+    private:
+        Location center_{};
+        unsigned mask_ = 0;
+    };
+
+    iterator begin() const { return {center_, mask_}; }
+    iterator end() const { return {center_, 0}; }
+    bool empty() const { return mask_ == 0; }
+    size_t size() const { return std::popcount(mask_); }
+
+private:
+    Location center_{};
+    unsigned mask_ = 0;
+};
+
+// A rows x cols maze as a row-major bitset of blocked cells, framed by a
+// border of blocked cells so that a neighbour of any inner cell is always
+// a valid index. One bit per cell keeps far more of a big grid in cache
+// than a Cell per cell would; the Cells, needed only to show start, goal
+// and path, are filled in the first time one of those is marked.
+// index_columns() adds a column-major copy of the bitset, so a column can
+// be scanned a word at a time too.
+//
+// The bitset may instead live in memory someone else owns, such as a
+// mapped file; storage then keeps that memory alive.
+class Grid {
+public:
+    Grid(int rows, int cols)
+        : Grid(rows, cols, CellBitset(padded_size(rows, cols)), nullptr)
+    {
+        for (int c = -1; c <= cols; ++c) {
+            block({-1, c});
+            block({rows, c});
+        }
+        for (int r = 0; r < rows; ++r) {
+            block({r, -1});
+            block({r, cols});
+        }
+    }
+
+    // A grid over padded_size(rows, cols) bits at blocked, border included.
+    Grid(int rows, int cols, uint64_t* blocked, std::shared_ptr<void> storage)
+        : Grid(rows, cols, CellBitset(blocked, (padded_size(rows, cols) + 63) / 64), std::move(storage)) {}
+
+    // Bits in the bitset of a rows x cols grid, border included.
+    static size_t padded_size(int rows, int cols) {
+        return (static_cast<size_t>(rows) + 2) * (static_cast<size_t>(cols) + 2);
+    }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    size_t stride() const { return stride_; }
+    // Number of cells including the border, the bound for index().
+    size_t size() const { return padded_size(rows_, cols_); }
+
+    size_t index(const Location& l) const {
+        return static_cast<size_t>(l.row + 1) * stride_ + (l.col + 1);
+    }
+    Location location(size_t i) const {
+        return {static_cast<int>(i / stride_) - 1, static_cast<int>(i % stride_) - 1};
+    }
+    // Position of l in blocked_columns(), whose columns are rows() + 2
+    // bits apart.
+    size_t column_index(const Location& l) const {
+        return static_cast<size_t>(l.col + 1) * (static_cast<size_t>(rows_) + 2) + (l.row + 1);
+    }
+
+    bool contains(const Location& l) const {
+        return 0 <= l.row && l.row < rows_ && 0 <= l.col && l.col < cols_;
+    }
+    // The border counts as blocked, so l may be up to one step outside.
+    bool is_blocked(const Location& l) const { return blocked_.test(index(l)); }
+    const CellBitset& blocked() const { return blocked_; }
+    // Empty until index_columns().
+    const CellBitset& blocked_columns() const { return blocked_columns_; }
+
+    // Builds the column-major copy of the bitset.
+    void index_columns() {
+        if (!blocked_columns_.empty()) return;
+        blocked_columns_ = CellBitset(size());
+        for (int r = -1; r <= rows_; ++r) {
+            for (int c = -1; c <= cols_; ++c) {
+                if (is_blocked({r, c})) blocked_columns_.set(column_index({r, c}));
+            }
+        }
+    }
+
+    Cell operator[](const Location& l) const {
+        assert(contains(l));
+        if (cells_.empty()) return is_blocked(l) ? Cell::Blocked : Cell::Empty;
+        return cells_[index(l)];
+    }
+
+    void set(const Location& l, Cell c) {
+        assert(contains(l));
+        const auto i = index(l);
+        if (cells_.empty() && c != Cell::Empty && c != Cell::Blocked) {
+            cells_.resize(size(), Cell::Empty);
+            for (size_t j = 0; j < size(); ++j) {
+                if (blocked_.test(j)) cells_[j] = Cell::Blocked;
+            }
+        }
+        if (!cells_.empty()) cells_[i] = c;
+        if (c == Cell::Blocked) {
+            blocked_.set(i);
+            if (!blocked_columns_.empty()) blocked_columns_.set(column_index(l));
+        } else {
+            blocked_.reset(i);
+            if (!blocked_columns_.empty()) blocked_columns_.reset(column_index(l));
+        }
+    }
+
+    // Open cells one orthogonal step from l.
+    NeighborRange<false> neighbors(const Location& l) const {
+        const auto i = index(l);
+        unsigned mask = 0;
+        for (size_t k = 0; k < orthogonal_offsets_.size(); ++k) {
+            mask |= unsigned{!blocked_.test(i + orthogonal_offsets_[k])} << k;
+        }
+        return {l, mask};
+    }
+
+    // Cells one orthogonal step from which l can be entered. Moves are
+    // reversible between open cells; nothing leads into a blocked one.
+    NeighborRange<false> predecessors(const Location& l) const {
+        return is_blocked(l) ? NeighborRange<false>{} : neighbors(l);
+    }
+
+    // Open cells one king's move from l. A diagonal step may not cut the
+    // corner of a blocked cell.
+    NeighborRange<true> diagonal_neighbors(const Location& l) const {
+        const auto i = index(l);
+        unsigned open = 0;
+        for (size_t k = 0; k < king_offsets_.size(); ++k) {
+            open |= unsigned{!blocked_.test(i + king_offsets_[k])} << k;
+        }
+        // Bits 1, 3, 4, 6 are up, left, right, down.
+        auto corner = [open](unsigned k, unsigned a, unsigned b) {
+            return (open >> k & open >> a & open >> b & 1) << k;
+        };
+        return {l, (open & 0b01011010) | corner(0, 1, 3) | corner(2, 1, 4) | corner(5, 6, 3) | corner(7, 6, 4)};
+    }
+
+private:
+    int rows_, cols_;
+    size_t stride_;
+    std::shared_ptr<void> storage_;
+    CellBitset blocked_, blocked_columns_;
+    std::vector<Cell> cells_;
+    std::array<std::ptrdiff_t, 4> orthogonal_offsets_;
+    std::array<std::ptrdiff_t, 8> king_offsets_;
+
+    Grid(int rows, int cols, CellBitset blocked, std::shared_ptr<void> storage)
+        : rows_(rows), cols_(cols), stride_(static_cast<size_t>(cols) + 2), storage_(std::move(storage)), blocked_(std::move(blocked))
+    {
+        const std::array<std::ptrdiff_t, 3> step{-static_cast<std::ptrdiff_t>(stride_), 0, static_cast<std::ptrdiff_t>(stride_)};
+        for (size_t k = 0; k < orthogonal_moves.size(); ++k) {
+            orthogonal_offsets_[k] = step[orthogonal_moves[k].row + 1] + orthogonal_moves[k].col;
+        }
+        for (size_t k = 0; k < king_moves.size(); ++k) {
+            king_offsets_[k] = step[king_moves[k].row + 1] + king_moves[k].col;
+        }
+    }
+
+    void block(const Location& l) {
+        blocked_.set(index(l));
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Grid& m) {
+    for (int r = 0; r < m.rows(); ++r) {
+        for (int c = 0; c < m.cols(); ++c) os << m[{r, c}];
+        os << '\n';
+    }
+    return os;
+}
+
+#endif
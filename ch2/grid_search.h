@@ -0,0 +1,111 @@
+#ifndef GRID_SEARCH_H
+#define GRID_SEARCH_H
+
+#include "bfs.h"
+#include "dary_heap.h"
+#include "grid.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+// A* on a Grid, as bfs.h's a_star() runs it on cells, for answering many
+// queries one after another. All the search state lives in buffers made
+// once: a record per cell holding its g-score and parent, and the open
+// list. Each record is stamped with the generation of the search that
+// last wrote it, so a record from an earlier search reads as unvisited and
+// starting a search costs nothing. Once the heap has grown to the largest
+// frontier seen, a search allocates no memory. The records take
+// bytes_per_cell per cell, so keep one GridSearch per thread, not per
+// query. They start out as zero pages from calloc, generation 0 meaning
+// never visited, so only the cells a search reaches cost memory.
+template <bool diagonal>
+class GridSearch {
+public:
+    struct Route {
+        size_t cells = 0; // 0 when there is no path
+        double cost = 0;
+        size_t expanded = 0;
+    };
+
+    static constexpr size_t bytes_per_cell = 16;
+
+    explicit GridSearch(const Grid& m) : m_(m), frontier_(deeper_on_ties) {
+        if (m.size() >= UINT32_MAX) throw std::length_error("grid too large to search");
+        records_.reset(static_cast<Record*>(std::calloc(m.size(), sizeof(Record))));
+        if (!records_) throw std::bad_alloc();
+    }
+
+    Route search(const Location& start, const Location& goal) {
+        if (++generation_ == 0) {
+            // Wrapped: old stamps could now look current.
+            std::memset(static_cast<void*>(records_.get()), 0, m_.size() * sizeof(Record));
+            generation_ = 1;
+        }
+        frontier_.clear();
+        Route route;
+        const auto goal_index = static_cast<uint32_t>(m_.index(goal));
+        const auto start_index = static_cast<uint32_t>(m_.index(start));
+        records_[start_index] = {generation_, UINT32_MAX, 0};
+        frontier_.push({h(start, goal), 0, start_index});
+        while (!frontier_.empty()) {
+            const auto current = frontier_.top();
+            frontier_.pop();
+            if (current.g > records_[current.cell].g) continue; // superseded
+            if (current.cell == goal_index) {
+                route.cost = current.g;
+                for (auto i = current.cell; i != UINT32_MAX; i = records_[i].parent) ++route.cells;
+                return route;
+            }
+            ++route.expanded;
+            const auto l = m_.location(current.cell);
+            auto relax = [&](const Location& n, double step) {
+                const auto j = static_cast<uint32_t>(m_.index(n));
+                const auto g = current.g + step;
+                auto& r = records_[j];
+                if (r.generation == generation_ && r.g <= g) return;
+                r = {generation_, current.cell, g};
+                frontier_.push({g + h(n, goal), g, j});
+            };
+            if constexpr (diagonal) {
+                for (const auto& [n, step] : m_.diagonal_neighbors(l)) relax(n, step);
+            } else {
+                for (const auto& n : m_.neighbors(l)) relax(n, 1.0);
+            }
+        }
+        return route;
+    }
+
+private:
+    // All zero bytes until first visited.
+    struct Record {
+        uint32_t generation;
+        uint32_t parent;
+        double g;
+    };
+    static_assert(sizeof(Record) == bytes_per_cell);
+    struct Free {
+        void operator()(Record* p) const { std::free(p); }
+    };
+    struct Entry {
+        double f, g;
+        uint32_t cell;
+    };
+    static bool deeper_on_ties(const Entry& lhs, const Entry& rhs) {
+        return lhs.f < rhs.f || (lhs.f == rhs.f && lhs.g > rhs.g);
+    }
+
+    const Grid& m_;
+    std::unique_ptr<Record[], Free> records_;
+    DaryHeap<Entry, bool (*)(const Entry&, const Entry&)> frontier_;
+    uint32_t generation_ = 0;
+
+    static double h(const Location& l, const Location& goal) {
+        return diagonal ? octile_distance(l, goal) : manhattan_distance(l, goal);
+    }
+};
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef JUMP_POINT_SEARCH_H
+#define JUMP_POINT_SEARCH_H
+
+#include "bfs.h"
+#include "grid.h"
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <span>
+#include <utility>
+
+// Jump Point Search (Harabor and Grastien) on a Grid with unit-cost moves.
+// On an open grid many shortest paths differ only in the order of their
+// moves; JPS keeps one of them by pruning the neighbours a path could
+// reach as cheaply without passing through the current cell, and by
+// running straight on until it meets a cell where that stops being true,
+// the goal, or a wall. Only those jump points enter the open list.
+namespace jps_detail {
+
+// First cell from `from` on, stepping forward (+1) or back along a line
+// of bits, that is blocked, is target, or has a forced neighbour: an open
+// cell in a neighbouring line, side bits away, whose predecessor along
+// the line is blocked. Returns that cell and whether it is open. The line
+// is scanned a word at a time; the grid's border ends every scan.
+inline std::pair<std::ptrdiff_t, bool> scan(
+        const CellBitset& blocked, std::ptrdiff_t from, bool forward, std::ptrdiff_t side, std::ptrdiff_t target)
+{
+    if (forward) {
+        for (auto p = from;; p += 64) {
+            const auto here = blocked.window(p);
+            auto stop = here
+                | (~blocked.window(p - side) & blocked.window(p - side - 1))
+                | (~blocked.window(p + side) & blocked.window(p + side - 1));
+            if (p <= target && target - p < 64) stop |= uint64_t{1} << (target - p);
+            if (stop) {
+                const auto k = std::countr_zero(stop);
+                return {p + k, !(here >> k & 1)};
+            }
+        }
+    }
+    for (auto p = from - 63;; p -= 64) {
+        const auto here = blocked.window(p);
+        auto stop = here
+            | (~blocked.window(p - side) & blocked.window(p - side + 1))
+            | (~blocked.window(p + side) & blocked.window(p + side + 1));
+        if (p <= target && target - p < 64) stop |= uint64_t{1} << (target - p);
+        if (stop) {
+            const auto k = 63 - std::countl_zero(stop);
+            return {p + k, !(here >> k & 1)};
+        }
+    }
+}
+
+// Jump from l along a row (dr == 0) or a column (dc == 0).
+inline std::optional<Location> jump_straight(const Grid& m, const Location& l, int dr, int dc, const Location& goal) {
+    if (dr == 0) {
+        const std::ptrdiff_t i = m.index(l);
+        const auto [p, open] = scan(m.blocked(), i + dc, dc > 0, m.stride(), m.index(goal));
+        return open ? std::optional{Location{l.row, static_cast<int>(l.col + (p - i))}} : std::nullopt;
+    }
+    if (m.blocked_columns().empty()) {
+        // No column-major copy: walk the column a cell at a time.
+        for (Location c{l.row + dr, l.col};; c.row += dr) {
+            if (m.is_blocked(c)) return std::nullopt;
+            if (c == goal) return c;
+            for (const auto dc : {-1, 1}) {
+                if (!m.is_blocked({c.row, c.col + dc}) && m.is_blocked({c.row - dr, c.col + dc})) return c;
+            }
+        }
+    }
+    const std::ptrdiff_t i = m.column_index(l);
+    const auto [p, open] = scan(m.blocked_columns(), i + dr, dr > 0, m.rows() + 2, m.column_index(goal));
+    return open ? std::optional{Location{static_cast<int>(l.row + (p - i)), l.col}} : std::nullopt;
+}
+
+// With 4-connected moves a path turns off a column anywhere, so each
+// cell of a vertical jump looks along its row in both directions.
+inline std::optional<Location> jump_vertical(const Grid& m, const Location& l, int dr, const Location& goal) {
+    for (Location c{l.row + dr, l.col};; c.row += dr) {
+        if (m.is_blocked(c)) return std::nullopt;
+        if (c == goal) return c;
+        for (const auto dc : {-1, 1}) {
+            if (!m.is_blocked({c.row, c.col + dc}) && m.is_blocked({c.row - dr, c.col + dc})) return c;
+        }
+        if (jump_straight(m, c, 0, 1, goal) || jump_straight(m, c, 0, -1, goal)) return c;
+    }
+}
+
+// 8-connected diagonal jump. Moves may not cut corners, so a diagonal
+// step needs both cells beside it open and has no forced neighbours of
+// its own; a cell is a jump point when a straight jump from it finds one.
+inline std::optional<Location> jump_diagonal(const Grid& m, const Location& l, int dr, int dc, const Location& goal) {
+    for (auto c = l;;) {
+        if (m.is_blocked({c.row + dr, c.col}) || m.is_blocked({c.row, c.col + dc})) return std::nullopt;
+        c = {c.row + dr, c.col + dc};
+        if (m.is_blocked(c)) return std::nullopt;
+        if (c == goal) return c;
+        if (jump_straight(m, c, 0, dc, goal) || jump_straight(m, c, dr, 0, goal)) return c;
+    }
+}
+
+// A jump point and the direction it was reached in, (0, 0) at the start.
+struct JumpNode {
+    Location at;
+    int dr, dc;
+};
+
+// The successors of one jump point, held inline.
+struct JumpSuccessors {
+    std::array<std::pair<JumpNode, double>, 8> items;
+    size_t count = 0;
+
+    auto begin() const { return items.begin(); }
+    auto end() const { return items.begin() + count; }
+};
+
+template <bool diagonal>
+JumpSuccessors jump_successors(const Grid& m, const JumpNode& n, const Location& goal) {
+    const auto [l, dr, dc] = n;
+    // Directions that survive pruning, as (dr, dc) pairs.
+    std::array<std::pair<int, int>, 8> directions;
+    size_t count = 0;
+    if (dr == 0 && dc == 0) {
+        for (const auto& [r, c] : diagonal ? std::span<const Location>{king_moves} : std::span<const Location>{orthogonal_moves}) {
+            directions[count++] = {r, c};
+        }
+    } else if (!diagonal) {
+        directions[count++] = {dr, dc};
+        directions[count++] = {dc, dr};
+        directions[count++] = {-dc, -dr};
+    } else if (dr != 0 && dc != 0) {
+        directions[count++] = {dr, 0};
+        directions[count++] = {0, dc};
+        directions[count++] = {dr, dc};
+    } else {
+        // Straight on, and to either side square or diagonally forward.
+        directions[count++] = {dr, dc};
+        for (const auto& [r, c] : {std::pair{dc, dr}, std::pair{-dc, -dr}}) {
+            directions[count++] = {r, c};
+            directions[count++] = {dr + r, dc + c};
+        }
+    }
+    JumpSuccessors successors;
+    for (size_t k = 0; k < count; ++k) {
+        const auto [r, c] = directions[k];
+        const auto jump = r != 0 && c != 0 ? jump_diagonal(m, l, r, c, goal)
+                        : !diagonal && r != 0 ? jump_vertical(m, l, r, goal)
+                        : jump_straight(m, l, r, c, goal);
+        if (!jump) continue;
+        const auto steps = std::max(std::abs(jump->row - l.row), std::abs(jump->col - l.col));
+        successors.items[successors.count++] = {{*jump, r, c}, r != 0 && c != 0 ? steps * std::sqrt(2.0) : steps};
+    }
+    return successors;
+}
+
+} // namespace jps_detail
+
+// Shortest path from start to goal with 4-connected or, when diagonal,
+// 8-connected moves that do not cut corners. The path lists every cell,
+// as the other solvers' do; expanded counts jump points.
+template <bool diagonal>
+SearchResult<Location> jump_point_search(const Grid& m, const Location& start, const Location& goal) {
+    using namespace jps_detail;
+    auto result = a_star(
+        JumpNode{start, 0, 0},
+        [&goal](const JumpNode& n) { return n.at == goal; },
+        [&m, &goal](const JumpNode& n) { return jump_successors<diagonal>(m, n, goal); },
+        [&goal](const JumpNode& n) { return diagonal ? octile_distance(n.at, goal) : manhattan_distance(n.at, goal); },
+        [&m](const JumpNode& n) { return m.index(n.at); },
+        m.size());
+    SearchResult<Location> cells{{}, result.cost, result.expanded};
+    for (const auto& n : result.path) {
+        if (!cells.path.empty()) {
+            for (auto c = cells.path.back(); !(c == n.at);) {
+                c = {c.row + n.dr, c.col + n.dc};
+                cells.path.push_back(c);
+            }
+        } else {
+            cells.path.push_back(n.at);
+        }
+    }
+    return cells;
+}
+
+#endif
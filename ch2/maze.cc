@@ -1,235 +1,461 @@
+#include "bfs.h"
+#include "components.h"
+#include "grid.h"
+#include "grid_search.h"
+#include "jump_point_search.h"
+#include "maze_file.h"
+#include "node_arena.h"
 #include "prettyprint.hpp"
-#include "range/v3/all.hpp"
-#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
-#include <deque>
+#include <fstream>
 #include <iostream>
-#include <map>
+#include <iterator>
+#include <optional>
 #include <queue>
-#include <set>
 #include <stack>
-#include <tuple>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <unistd.h>
 #include <vector>
 
-enum class Cell: char {
-    Empty = ' ',
-    Blocked = '#',
-    Start = 'S',
-    Goal = 'G',
-    Path = '.',
-};
-
-std::ostream& operator<<(std::ostream& os, Cell c) {
-    return os << static_cast<char>(c);
-}
-
-using Maze = std::vector<std::vector<Cell>>;
-
-struct Location { int row, col; };
+using Maze = Grid;
 
 Location pick_random_location(const Maze& m) {
-    return { int(rand() % m.size()), int(rand() % m[0].size()) };
-}
-
-bool operator==(const Location& lhs, const Location& rhs) {
-    return lhs.row == rhs.row && lhs.col == rhs.col;
-}
-
-bool operator<(const Location& lhs, const Location& rhs) {
-    return lhs.row < rhs.row || (lhs.row == rhs.row && lhs.col < rhs.col);
-}
-
-std::ostream& operator<<(std::ostream& os, const Location& l) {
-    return os << '{' << l.row << ',' << l.col << '}';
-}
-
-bool is_within_maze(const Maze& m, const Location& l) {
-    return (0 <= l.row && static_cast<size_t>(l.row) < m.size())
-        && (0 <= l.col && static_cast<size_t>(l.col) < m[l.row].size());
-}
-
-bool is_cell_blocked(const Maze& m, const Location& l) {
-    assert(is_within_maze(m, l));
-    return m[l.row][l.col] == Cell::Blocked;
+    return { int(rand() % m.rows()), int(rand() % m.cols()) };
 }
 
 Maze generate_maze(int rows, int cols, double sparseness) {
-    Maze m(rows);
-    for (auto& row : m) {
-        row.assign(cols, Cell::Empty);
-        for (auto& cell : row) {
-            if (1.0 * rand() / RAND_MAX < sparseness) cell = Cell::Blocked;
+    Maze m(rows, cols);
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            if (1.0 * rand() / RAND_MAX < sparseness) m.set({r, c}, Cell::Blocked);
         }
     }
     return m;
 }
 
 void mark_start_location(Maze& m, const Location& s) {
-    assert(is_within_maze(m, s));
-    m[s.row][s.col] = Cell::Start;
+    m.set(s, Cell::Start);
 }
 
 void mark_goal_location(Maze& m, const Location& g) {
-    assert(is_within_maze(m, g));
-    m[g.row][g.col] = Cell::Goal;
-}
-
-std::ostream& operator<<(std::ostream& os, const Maze& m) {
-    for (const auto& row : m) {
-        for (const auto& cell : row) os << cell;
-        os << '\n';
-    }
-    return os;
-}
-
-using Successors = std::vector<Location>;
-
-Successors successors_for_maze(const Maze& m, const Location& l) {
-    using namespace ranges::view;
-    Successors candidates {
-        {l.row - 1, l.col},
-        {l.row, l.col + 1},
-        {l.row + 1, l.col},
-        {l.row, l.col - 1},
-    };
-    return candidates | remove_if([&m](const Location& c) {
-            return !is_within_maze(m, c) || is_cell_blocked(m, c);
-            });
+    m.set(g, Cell::Goal);
 }
 
-struct Node {
-    Location location;
-    const Node * parent;
-    int cost;
-};
-
-bool operator<(const Node& lhs, const Node& rhs) {
-    return lhs.location < rhs.location;
-}
-
-bool operator==(const Node& lhs, const Node& rhs) {
-    return lhs.location == rhs.location;
-}
-
-std::ostream& operator<<(std::ostream& os, const Node& n) {
-    return os << '{' << n.location << ',' << n.parent << ',' << n.cost << '}';
-}
-
-using Path = std::vector<Location>;
-
-Path build_path(const Node* n) {
-    assert(n);
-    Path p;
-    while (n) {
-        p.push_back(n->location);
-        n = n->parent;
-    }
-    return p;
-}
-
-Path dfs(const Maze& m, const Location& start, const Location& goal) {
-    std::stack<Node> frontier{std::deque<Node>{{start}}};
-    std::set<Node> explored;
-    auto it = explored.end();
+// A cell is marked explored when it is expanded, not when it is pushed,
+// so it can be pushed more than once; its first expansion is the parent of
+// everything pushed from it later.
+Path<Location> dfs(const Maze& m, const Location& start, const Location& goal, size_t& expanded) {
+    constexpr auto unexplored = UINT32_MAX;
+    NodeArena<Location> nodes;
+    std::vector<uint32_t> explored(m.size(), unexplored);
+    std::stack<uint32_t, std::vector<uint32_t>> frontier;
+    frontier.push(nodes.push(start));
     do {
-        const auto current_node = frontier.top();
-        const auto current_location = current_node.location;
+        const auto current = frontier.top();
+        const auto current_location = nodes[current].state;
         if (current_location == goal) {
-            return build_path(&current_node);
+            return build_path(nodes, current);
         }
         frontier.pop();
-        std::tie(it, std::ignore) = explored.insert(current_node);
-        for (const auto& s : successors_for_maze(m, current_location)) {
-            Node n{s, &*it};
-            if (explored.find(n) == explored.end()) frontier.push(n);
+        ++expanded;
+        auto& first = explored[m.index(current_location)];
+        if (first == unexplored) first = current;
+        for (const auto& s : m.neighbors(current_location)) {
+            if (explored[m.index(s)] == unexplored) frontier.push(nodes.push(s, first));
         }
     } while (!frontier.empty());
     return {};
 }
 
-Path bfs(const Maze& m, const Location& start, const Location& goal) {
-    std::deque<Node> frontier{{start}};
-    std::set<Node> explored;
-    auto it = explored.end();
-    do {
-        const auto current_node = frontier.front();
-        const auto current_location = current_node.location;
+// The arena holds the nodes in the order they are queued, so it is the
+// queue as well: the frontier is every node from head on.
+Path<Location> bfs(const Maze& m, const Location& start, const Location& goal, size_t& expanded) {
+    NodeArena<Location> nodes;
+    CellBitset explored(m.size());
+    explored.insert(m.index(start));
+    nodes.push(start);
+    for (uint32_t head = 0; head < nodes.size(); ++head) {
+        const auto current_location = nodes[head].state;
         if (current_location == goal) {
-            return build_path(&current_node);
+            return build_path(nodes, head);
         }
-        std::tie(it, std::ignore) = explored.insert(current_node);
-        for (const auto& s : successors_for_maze(m, current_location)) {
-            Node n{s, &*it};
-            if (explored.find(n) == explored.end()) frontier.push_back(n);
+        ++expanded;
+        for (const auto& s : m.neighbors(current_location)) {
+            if (explored.insert(m.index(s))) nodes.push(s, head);
         }
-        frontier.pop_front();
-    } while (!frontier.empty());
+    }
     return {};
 }
 
-Path a_star(const Maze& m, const Location& start, const Location& goal) {
-    auto cmp = [](const Node& lhs, const Node& rhs) { return lhs.cost > rhs.cost; };
-    std::priority_queue<Node, std::vector<Node>, decltype(cmp)> frontier{cmp, {{start}}};
-    std::map<Node, int> explored;
-    auto it = explored.end();
-    bool success;
+struct Candidate {
+    int cost;
+    uint32_t node;
+};
+
+Path<Location> a_star(const Maze& m, const Location& start, const Location& goal, size_t& expanded) {
+    auto cmp = [](const Candidate& lhs, const Candidate& rhs) { return lhs.cost > rhs.cost; };
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(cmp)> frontier{cmp};
+    NodeArena<Location> nodes;
+    std::vector<int> explored(m.size(), INT_MAX);
+    explored[m.index(start)] = 0;
+    frontier.push({0, nodes.push(start)});
     do {
-        const auto current_node = frontier.top();
-        const auto current_location = current_node.location;
+        const auto [cost, current] = frontier.top();
+        frontier.pop();
+        const auto current_location = nodes[current].state;
         if (current_location == goal) {
-            return build_path(&current_node);
+            return build_path(nodes, current);
         }
-        const auto cost = current_node.cost;
-        std::tie(it, success) = explored.insert({current_node, cost});
-        if (!success) { // node was already explored, update cost
-            explored[current_node] = cost;
-        }
-        const auto parent = &it->first;
+        if (cost > explored[m.index(current_location)]) continue; // a cheaper copy was expanded already
+        ++expanded;
         const auto new_cost = cost + 1;
-        for (const auto& s : successors_for_maze(m, current_location)) {
-            Node n{s, parent, new_cost};
-            it = explored.find(n);
-            if (it == explored.end() || new_cost < it->second) frontier.push(n);
+        for (const auto& s : m.neighbors(current_location)) {
+            auto& best = explored[m.index(s)];
+            if (new_cost < best) {
+                best = new_cost;
+                frontier.push({new_cost, nodes.push(s, current)});
+            }
         }
-        frontier.pop();
     } while (!frontier.empty());
     return {};
 }
 
-void mark_path(Maze& m, Path p) {
+Path<Location> bidirectional(const Maze& m, const Location& start, const Location& goal, size_t& expanded) {
+    auto successors = [&m](const Location& l) { return m.neighbors(l); };
+    auto predecessors = [&m](const Location& l) { return m.predecessors(l); };
+    auto index = [&m](const Location& l) { return m.index(l); };
+    auto result = bidirectional_bfs(start, goal, successors, predecessors, index, m.size());
+    expanded = result.expanded;
+    return result.path;
+}
+
+enum class Heuristic { Manhattan, Euclidean, Octile };
+
+// A* from bfs.h on the maze, with g-scores indexed by cell.
+template <Heuristic heuristic, bool diagonal>
+Path<Location> heuristic_a_star(const Maze& m, const Location& start, const Location& goal, size_t& expanded) {
+    auto goal_test = [&goal](const Location& l) { return l == goal; };
+    auto index = [&m](const Location& l) { return m.index(l); };
+    auto h = [&goal](const Location& l) {
+        switch (heuristic) {
+            case Heuristic::Manhattan: return manhattan_distance(l, goal);
+            case Heuristic::Euclidean: return euclidean_distance(l, goal);
+            default: return octile_distance(l, goal);
+        }
+    };
+    const auto result = diagonal
+        ? a_star(start, goal_test, [&m](const Location& l) { return m.diagonal_neighbors(l); }, h, index, m.size())
+        : a_star(start, goal_test, [&m](const Location& l) { return m.neighbors(l); }, h, index, m.size());
+    expanded = result.expanded;
+    return result.path;
+}
+
+template <bool diagonal>
+Path<Location> jps(const Maze& m, const Location& start, const Location& goal, size_t& expanded) {
+    const auto result = jump_point_search<diagonal>(m, start, goal);
+    expanded = result.expanded;
+    return result.path;
+}
+
+void mark_path(Maze& m, Path<Location> p) {
     for (const auto& l : p) {
-        m[l.row][l.col] = Cell::Path;
+        m.set(l, Cell::Path);
+    }
+}
+
+// Whether goal can be reached from start. The solvers let a start on a
+// blocked cell step off it, so such a start reaches what its neighbours do.
+bool reachable(const Maze& m, const ComponentIndex& components, const Location& start, const Location& goal) {
+    if (start == goal) return true;
+    if (!m.is_blocked(start)) return components.connected(start, goal);
+    for (const auto& n : m.neighbors(start)) {
+        if (components.connected(n, goal)) return true;
     }
+    return false;
 }
 
-using MazeSolver = Path(*)(const Maze&, const Location&, const Location&);
+// Reads queries "start_row start_col goal_row goal_col", one per line.
+// The input is read whole and parsed with from_chars, which for millions
+// of queries costs far less than operator>>.
+std::vector<std::pair<Location, Location>> read_queries(const Maze& m, std::istream& in) {
+    const std::string text{std::istreambuf_iterator<char>{in}, {}};
+    const char* p = text.data();
+    const char* const end = p + text.size();
+    size_t queries = 0;
+    auto bad_query = [&queries]() {
+        return std::runtime_error("query " + std::to_string(queries) + ": expected four numbers");
+    };
+    // Reads the next number; false at the end of the input.
+    auto next = [&](int& x) {
+        while (p != end && std::isspace(static_cast<unsigned char>(*p))) ++p;
+        if (p == end) return false;
+        const auto [q, error] = std::from_chars(p, end, x);
+        if (error != std::errc{}) throw bad_query();
+        p = q;
+        return true;
+    };
+    std::vector<std::pair<Location, Location>> batch;
+    Location start, goal;
+    while (next(start.row)) {
+        ++queries;
+        if (!next(start.col) || !next(goal.row) || !next(goal.col)) throw bad_query();
+        if (!m.contains(start) || !m.contains(goal)) {
+            throw std::runtime_error("query " + std::to_string(queries) + ": outside the maze");
+        }
+        batch.push_back({start, goal});
+    }
+    return batch;
+}
 
+// Answers each query with 1 or 0, then prints a summary.
+void answer_reachability(const Maze& m, const ComponentIndex& components, std::istream& in, bool quiet) {
+    const auto started = std::chrono::steady_clock::now();
+    const auto batch = read_queries(m, in);
+    size_t reached = 0;
+    // Each query is a few cache misses into a label array far bigger than
+    // the cache; prefetching those a few queries ahead overlaps them.
+    constexpr size_t ahead = 16;
+    std::string answers;
+    for (size_t k = 0; k < batch.size(); ++k) {
+        if (k + ahead < batch.size()) {
+            components.prefetch(batch[k + ahead].first);
+            components.prefetch(batch[k + ahead].second);
+        }
+        const auto yes = reachable(m, components, batch[k].first, batch[k].second);
+        reached += yes;
+        if (!quiet) answers += yes ? "1\n" : "0\n";
+    }
+    std::cout << answers;
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+    std::cout << batch.size() << " queries, " << reached << " reachable, " << elapsed.count() << " ms\n";
+}
+
+// Solves each query with A* on threads threads sharing the maze, each with
+// its own GridSearch, and prints the path length in cells (0 for none),
+// then a summary with percentiles of the time taken per query. With
+// components labelled, a goal in another region is rejected without a
+// search.
+template <bool diagonal>
+void solve_batch(const Maze& m, const ComponentIndex* components, std::istream& in, unsigned threads, bool quiet) {
+    using Clock = std::chrono::steady_clock;
+    const auto batch = read_queries(m, in);
+    std::vector<size_t> cells(batch.size());
+    std::vector<double> latency(batch.size()); // microseconds
+    std::atomic<size_t> next{0}, expanded{0};
+    auto work = [&]() {
+        GridSearch<diagonal> search(m);
+        size_t own_expanded = 0;
+        for (size_t k; (k = next.fetch_add(1, std::memory_order_relaxed)) < batch.size();) {
+            const auto& [start, goal] = batch[k];
+            const auto started = Clock::now();
+            if (!components || reachable(m, *components, start, goal)) {
+                const auto route = search.search(start, goal);
+                cells[k] = route.cells;
+                own_expanded += route.expanded;
+            }
+            latency[k] = std::chrono::duration<double, std::micro>(Clock::now() - started).count();
+        }
+        expanded += own_expanded;
+    };
+    const auto started = Clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    const std::chrono::duration<double, std::milli> elapsed = Clock::now() - started;
+    if (!quiet) {
+        std::string answers;
+        for (const auto n : cells) answers += std::to_string(n) + '\n';
+        std::cout << answers;
+    }
+    const auto solved = batch.size() - std::count(cells.begin(), cells.end(), 0);
+    std::cout
+        << batch.size() << " queries, " << solved << " solved, expanded = " << expanded << ", "
+        << elapsed.count() << " ms on " << threads << " threads\n";
+    if (batch.empty()) return;
+    std::sort(latency.begin(), latency.end());
+    auto percentile = [&latency](double p) { return latency[static_cast<size_t>(p / 100 * (latency.size() - 1))]; };
+    std::cout
+        << "latency us: p50 = " << percentile(50) << ", p90 = " << percentile(90) << ", p99 = " << percentile(99)
+        << ", max = " << latency.back() << '\n';
+}
+
+using MazeSolver = Path<Location>(*)(const Maze&, const Location&, const Location&, size_t&);
+
+template <bool diagonal>
+MazeSolver pick_heuristic_a_star(Heuristic h) {
+    switch (h) {
+        case Heuristic::Manhattan: return heuristic_a_star<Heuristic::Manhattan, diagonal>;
+        case Heuristic::Euclidean: return heuristic_a_star<Heuristic::Euclidean, diagonal>;
+        default: return heuristic_a_star<Heuristic::Octile, diagonal>;
+    }
+}
+
+//     maze [-a | -A [-h m|e|o] [-8] | -b | -B | -d | -j [-8]]
+//          [-s size] [-S seed | -f file | -r text] [-w file] [-c] [-R queries | -Q queries [-8]]
+//          [-t threads] [-q]
+//
+// -a is the uniform-cost search, -A the A* from bfs.h with a Manhattan,
+// Euclidean or octile heuristic. -8 lets -A and -j move diagonally; -A
+// then defaults to octile and refuses Manhattan, which would overestimate.
+// -B searches from both ends, -j with Jump Point Search.
+//
+// The maze is random unless -f maps a maze file (see maze_file.h) or -r
+// reads one as the maze is printed ('-' for stdin); a start or goal the
+// maze lacks is picked at random. -w saves the maze to a maze file instead
+// of solving it, so "maze -r maze.txt -w maze.bin" converts. -q leaves out
+// the maze itself, which is too big to read past a few hundred cells a
+// side. Mapping and saving take a maze of any size, but cells and search
+// nodes are numbered with 32 bits, so only mazes of fewer than 2^32 cells,
+// border included, about 65,000 a side, are solved. Per cell, -A and -B
+// also need 8 bytes, and -a and -d 4 bytes.
+//
+// -c labels the maze's connected regions first, on -t threads, so a goal
+// in another region is rejected without a search. -R answers a file of
+// reachability queries ('-' for stdin) from those labels instead of
+// solving; -q leaves out the answers and prints only the summary.
+//
+// -Q solves a file of such queries ('-' for stdin) with A* on -t threads,
+// printing each path's length in cells, or 0 when there is none, and
+// percentiles of the time per query. Each thread keeps up to 16 bytes of
+// search state per cell, reused from one query to the next and committed
+// only as searches reach cells; unless -t says otherwise, -Q runs no more
+// threads than fit in physical memory if all of it were committed.
 int main(int argc, char* argv[]) {
     MazeSolver solver = a_star;
+    std::optional<Heuristic> heuristic;
+    bool diagonal = false, informed = false, jump = false, quiet = false;
     unsigned seed = time(nullptr);
     int size = 10;
     double sparseness = 0.2;
+    bool label = false;
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    bool threads_given = false;
+    std::string maze_path, text_path, output_path, query_path, route_path;
     int c;
-    while ((c = getopt(argc, argv, "abds:S:")) != -1) {
+    while ((c = getopt(argc, argv, "aAbBdj8h:qs:S:f:r:w:cR:Q:t:")) != -1) {
         switch (c) {
             case 'a': solver = a_star; break;
+            case 'A': informed = true; break;
             case 'b': solver = bfs; break;
+            case 'B': solver = bidirectional; break;
             case 'd': solver = dfs; break;
+            case 'j': jump = true; break;
+            case '8': diagonal = true; break;
+            case 'h':
+                heuristic = optarg[0] == 'e' ? Heuristic::Euclidean
+                          : optarg[0] == 'o' ? Heuristic::Octile
+                          : Heuristic::Manhattan;
+                break;
+            case 'q': quiet = true; break;
             case 's': size = atoi(optarg); break;
             case 'S': seed = atoi(optarg); break;
+            case 'f': maze_path = optarg; break;
+            case 'r': text_path = optarg; break;
+            case 'w': output_path = optarg; break;
+            case 'c': label = true; break;
+            case 'R': query_path = optarg; label = true; break;
+            case 'Q': route_path = optarg; break;
+            case 't': threads = std::max(atoi(optarg), 1); threads_given = true; break;
         }
     }
-    srand(seed);
-    auto maze = generate_maze(size, size, sparseness);
-    auto start_location = pick_random_location(maze);
-    auto goal_location = pick_random_location(maze);
-    auto path = solver(maze, start_location, goal_location);
-    mark_path(maze, path);
-    mark_start_location(maze, start_location);
-    mark_goal_location(maze, goal_location);
-    std::cout
-        << "seed = " << seed << '\n'
-        << maze << '\n';
+    if (informed && diagonal && heuristic == Heuristic::Manhattan) {
+        // A diagonal step costs sqrt(2) but counts 2.
+        std::cerr << argv[0] << ": the Manhattan heuristic overestimates diagonal moves\n";
+        return 1;
+    }
+    if (informed) {
+        solver = diagonal
+            ? pick_heuristic_a_star<true>(heuristic.value_or(Heuristic::Octile))
+            : pick_heuristic_a_star<false>(heuristic.value_or(Heuristic::Manhattan));
+    }
+    if (jump) {
+        solver = diagonal ? jps<true> : jps<false>;
+    }
+    try {
+        srand(seed);
+        auto maze_file = [&]() {
+            if (!maze_path.empty()) return load_maze(maze_path);
+            if (text_path == "-") return read_maze_text(std::cin);
+            if (!text_path.empty()) {
+                std::ifstream in(text_path);
+                if (!in) throw std::runtime_error("cannot open " + text_path);
+                return read_maze_text(in);
+            }
+            return MazeFile{generate_maze(size, size, sparseness), {}, {}};
+        }();
+        auto& maze = maze_file.grid;
+        auto start_location = maze_file.start ? *maze_file.start : pick_random_location(maze);
+        auto goal_location = maze_file.goal ? *maze_file.goal : pick_random_location(maze);
+        if (!output_path.empty()) {
+            save_maze(output_path, {std::move(maze), start_location, goal_location});
+            return 0;
+        }
+        std::cout << "seed = " << seed << '\n';
+        if (maze.size() >= UINT32_MAX) throw std::runtime_error("too large to solve: 2^32 cells or more");
+        ComponentIndex components;
+        if (label) {
+            const auto started = std::chrono::steady_clock::now();
+            components.build(maze, threads);
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+            std::cout << "components = " << components.count() << ", labelled in " << elapsed.count() << " ms\n";
+        }
+        if (query_path == "-") {
+            answer_reachability(maze, components, std::cin, quiet);
+            return 0;
+        }
+        if (!query_path.empty()) {
+            std::ifstream in(query_path);
+            if (!in) throw std::runtime_error("cannot open " + query_path);
+            answer_reachability(maze, components, in, quiet);
+            return 0;
+        }
+        if (!route_path.empty()) {
+            if (!threads_given) {
+                // Enough threads to keep the cores busy, but no more than
+                // the memory can hold if every search reached every cell.
+                const auto memory = static_cast<size_t>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGE_SIZE);
+                const auto per_thread = maze.size() * GridSearch<false>::bytes_per_cell;
+                threads = std::clamp<size_t>(memory / per_thread, 1, threads);
+            }
+            auto solve = diagonal ? solve_batch<true> : solve_batch<false>;
+            const auto* labels = label ? &components : nullptr;
+            if (route_path == "-") {
+                solve(maze, labels, std::cin, threads, quiet);
+                return 0;
+            }
+            std::ifstream in(route_path);
+            if (!in) throw std::runtime_error("cannot open " + route_path);
+            solve(maze, labels, in, threads, quiet);
+            return 0;
+        }
+        if (jump) maze.index_columns();
+        size_t expanded = 0;
+        const auto started = std::chrono::steady_clock::now();
+        auto path = label && !reachable(maze, components, start_location, goal_location)
+            ? Path<Location>{}
+            : solver(maze, start_location, goal_location, expanded);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+        std::cout
+            << "expanded = " << expanded << ", path = " << path.size() << " cells, " << elapsed.count() << " ms\n";
+        if (!quiet) {
+            mark_path(maze, path);
+            mark_start_location(maze, start_location);
+            mark_goal_location(maze, goal_location);
+            std::cout << maze << '\n';
+        }
+    } catch (const std::exception& e) {
+        std::cerr << argv[0] << ": " << e.what() << '\n';
+        return 1;
+    }
 }
@@ -0,0 +1,143 @@
+#ifndef MAZE_FILE_H
+#define MAZE_FILE_H
+
+#include "../ch1/mapped_file.h"
+#include "grid.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Maze files are a 64-byte header followed by the grid's blocked-cell
+// bitset exactly as Grid keeps it: (rows + 2) x (cols + 2) cells, border
+// included, row-major, one bit per cell, bit i in bit i % 64 of the
+// little-endian 64-bit word i / 64. A loaded grid reads the bitmap where it
+// is mapped, so opening a file of any size costs no parsing and no
+// copying. Start and goal, if any, are kept in the header. Rows and columns
+// are 32-bit, but the searches in maze.cc index cells with 32 bits and
+// only solve mazes of fewer than 2^32 cells.
+struct MazeFileHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t rows, cols;
+    int32_t start_row, start_col; // -1 when there is none
+    int32_t goal_row, goal_col;
+    char reserved[28];
+};
+static_assert(sizeof(MazeFileHeader) == 64);
+static_assert(std::endian::native == std::endian::little, "maze files hold little-endian words");
+
+inline constexpr char maze_file_magic[8] = {'M', 'A', 'Z', 'E', 'B', 'I', 'T', 'S'};
+inline constexpr uint32_t maze_file_version = 1;
+
+struct MazeFile {
+    Grid grid;
+    std::optional<Location> start, goal;
+};
+
+// Writes a temporary file beside path and renames it over path, so path is
+// never left half written, and a maze mapped from path itself, as
+// "maze -f m.bin -w m.bin" does, stays intact while it is read.
+inline void save_maze(const std::string& path, const MazeFile& maze) {
+    const auto& m = maze.grid;
+    MazeFileHeader header{};
+    std::memcpy(header.magic, maze_file_magic, sizeof header.magic);
+    header.version = maze_file_version;
+    header.rows = m.rows();
+    header.cols = m.cols();
+    header.start_row = maze.start ? maze.start->row : -1;
+    header.start_col = maze.start ? maze.start->col : -1;
+    header.goal_row = maze.goal ? maze.goal->row : -1;
+    header.goal_col = maze.goal ? maze.goal->col : -1;
+    const auto temp = path + ".tmp";
+    std::ofstream out(temp, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof header);
+    out.write(reinterpret_cast<const char*>(m.blocked().words()), m.blocked().word_count() * sizeof(uint64_t));
+    out.close();
+    if (!out || std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        throw std::runtime_error("cannot write " + path);
+    }
+}
+
+// Maps path privately: marking a path on the grid touches a copy of the
+// pages concerned, never the file.
+inline MazeFile load_maze(const std::string& path) {
+    auto file = std::make_shared<MappedFile>(path, MappedFile::Mode::Private);
+    MazeFileHeader header;
+    if (file->size() < sizeof header) throw std::runtime_error(path + ": not a maze file");
+    std::memcpy(&header, file->data(), sizeof header);
+    if (std::memcmp(header.magic, maze_file_magic, sizeof header.magic) != 0) {
+        throw std::runtime_error(path + ": not a maze file");
+    }
+    if (header.version != maze_file_version) {
+        throw std::runtime_error(path + ": unsupported maze file version " + std::to_string(header.version));
+    }
+    // The border takes the row and column on either side, which must still
+    // be valid int coordinates.
+    if (header.rows <= 0 || header.cols <= 0 || header.rows > INT32_MAX - 2 || header.cols > INT32_MAX - 2) {
+        throw std::runtime_error(path + ": bad maze size");
+    }
+    const auto words = (Grid::padded_size(header.rows, header.cols) + 63) / 64;
+    if (file->size() < sizeof header + words * sizeof(uint64_t)) throw std::runtime_error(path + ": truncated");
+    auto bits = reinterpret_cast<uint64_t*>(file->data() + sizeof header);
+    MazeFile maze{Grid(header.rows, header.cols, bits, std::move(file)), {}, {}};
+    auto& m = maze.grid;
+    // Searches rely on the border to stay inside the grid.
+    for (int c = -1; c <= m.cols(); ++c) {
+        if (!m.is_blocked({-1, c}) || !m.is_blocked({m.rows(), c})) throw std::runtime_error(path + ": border not blocked");
+    }
+    for (int r = 0; r < m.rows(); ++r) {
+        if (!m.is_blocked({r, -1}) || !m.is_blocked({r, m.cols()})) throw std::runtime_error(path + ": border not blocked");
+    }
+    auto location = [&](int32_t row, int32_t col) -> std::optional<Location> {
+        if (row == -1 && col == -1) return std::nullopt;
+        if (!m.contains({row, col})) throw std::runtime_error(path + ": start or goal outside the maze");
+        return Location{row, col};
+    };
+    maze.start = location(header.start_row, header.start_col);
+    maze.goal = location(header.goal_row, header.goal_col);
+    return maze;
+}
+
+// Reads a maze as operator<< prints it: '#' for a blocked cell, ' ' or '.'
+// for an open one, 'S' and 'G' for start and goal. Short lines are padded
+// with open cells.
+inline MazeFile read_maze_text(std::istream& in) {
+    std::vector<std::string> lines;
+    size_t cols = 0;
+    for (std::string line; std::getline(in, line);) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        cols = std::max(cols, line.size());
+        lines.push_back(std::move(line));
+    }
+    while (!lines.empty() && lines.back().empty()) lines.pop_back();
+    if (lines.empty() || cols == 0) throw std::runtime_error("empty maze");
+    MazeFile maze{Grid(static_cast<int>(lines.size()), static_cast<int>(cols)), {}, {}};
+    for (size_t r = 0; r < lines.size(); ++r) {
+        for (size_t c = 0; c < lines[r].size(); ++c) {
+            const Location l{static_cast<int>(r), static_cast<int>(c)};
+            switch (static_cast<Cell>(lines[r][c])) {
+                case Cell::Blocked: maze.grid.set(l, Cell::Blocked); break;
+                case Cell::Empty:
+                case Cell::Path: break;
+                case Cell::Start: maze.start = l; break;
+                case Cell::Goal: maze.goal = l; break;
+                default:
+                    throw std::runtime_error("line " + std::to_string(r + 1) + ": unexpected '" + lines[r][c] + "'");
+            }
+        }
+    }
+    return maze;
+}
+
+#endif
@@ -1,9 +1,21 @@
+// Usage:
+//   missionaries [-n people] [-b boat] [-j threads] [-x]
+// Solves the missionaries and cannibals puzzle with people of each and a
+// boat holding up to boat (defaults 3 and 2). With -j the search runs on
+// that many threads; -x explores the whole state space instead of
+// stopping at the goal and reports its size.
+
 #include "bfs.h"
 #include "range/v3/all.hpp"
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <thread>
+#include <unistd.h>
 #include <vector>
 
-const unsigned MAX_NUM = 3;
+unsigned MAX_NUM = 3;
+unsigned BOAT = 2;
 
 enum class Side { EAST, WEST };
 
@@ -58,6 +70,12 @@ bool operator<(const MCState& lhs, const MCState& rhs) {
         || (lhs.west_bank_missionaries() == rhs.west_bank_missionaries() && lhs.west_bank_cannibals() < rhs.west_bank_cannibals());
 }
 
+struct MCStateHash {
+    size_t operator()(const MCState& s) const {
+        return (static_cast<size_t>(s.missionaries_) * (MAX_NUM + 1) + s.cannibals_) * 2 + (s.side_ == Side::WEST);
+    }
+};
+
 std::ostream& operator<<(std::ostream& os, const MCState& s) {
     return os
         << "On the west bank there are " << s.west_bank_missionaries()
@@ -75,16 +93,15 @@ std::vector<MCState> successorsMC(const MCState& s) {
     using namespace ranges::view;
     std::vector<MCState> successors;
     auto sign = (s.side() == Side::WEST) ? -1 : 1;
-    if (s.missionaries() > 1)
-        successors.push_back({s.west_bank_missionaries() + sign * 2, s.west_bank_cannibals(), s.other_side()});
-    if (s.missionaries() > 0)
-        successors.push_back({s.west_bank_missionaries() + sign * 1, s.west_bank_cannibals(), s.other_side()});
-    if (s.cannibals() > 1)
-        successors.push_back({s.west_bank_missionaries(), s.west_bank_cannibals() + sign * 2, s.other_side()});
-    if (s.cannibals() > 0)
-        successors.push_back({s.west_bank_missionaries(), s.west_bank_cannibals() + sign * 1, s.other_side()});
-    if (s.missionaries() > 0 && s.cannibals() > 0)
-        successors.push_back({s.west_bank_missionaries() + sign * 1, s.west_bank_cannibals() + sign * 1, s.other_side()});
+    auto cross = [&](int missionaries, int cannibals) {
+        successors.push_back({s.west_bank_missionaries() + sign * missionaries, s.west_bank_cannibals() + sign * cannibals, s.other_side()});
+    };
+    const int boat = BOAT;
+    for (int m = std::min(s.missionaries(), boat); m > 0; --m) cross(m, 0);
+    for (int c = std::min(s.cannibals(), boat); c > 0; --c) cross(0, c);
+    for (int m = 1; m <= s.missionaries() && m < boat; ++m) {
+        for (int c = 1; c <= s.cannibals() && m + c <= boat; ++c) cross(m, c);
+    }
     return successors | remove_if([](const MCState& s) { return !s.is_legal(); });
 }
 
@@ -115,6 +132,40 @@ void print_solution(const Path<MCState>& p) {
     }
 }
 
-int main() {
-    print_solution(bfs<MCState>(MCState{3, 3, Side::WEST}, goal_test, successorsMC));
+int main(int argc, char* argv[]) {
+    unsigned threads = 0;
+    bool exhaustive = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:b:j:x")) != -1) {
+        switch (opt) {
+        case 'n':
+            MAX_NUM = std::atoi(optarg);
+            break;
+        case 'b':
+            BOAT = std::atoi(optarg);
+            break;
+        case 'j':
+            threads = std::atoi(optarg);
+            break;
+        case 'x':
+            exhaustive = true;
+            break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-n people] [-b boat] [-j threads] [-x]\n";
+            return 1;
+        }
+    }
+    const MCState initial{static_cast<int>(MAX_NUM), static_cast<int>(MAX_NUM), Side::WEST};
+    if (threads == 0 && !exhaustive) {
+        print_solution(bfs<MCState>(initial, goal_test, successorsMC, MCStateHash{}));
+        return 0;
+    }
+    if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+    const auto start = std::chrono::steady_clock::now();
+    const auto result = exhaustive
+        ? parallel_bfs(initial, [](const MCState&) { return false; }, successorsMC, MCStateHash{}, threads)
+        : parallel_bfs(initial, goal_test, successorsMC, MCStateHash{}, threads);
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    if (!exhaustive) print_solution(result.path);
+    std::cout << "expanded " << result.expanded << " states on " << threads << " threads in " << elapsed.count() << " ms\n";
 }
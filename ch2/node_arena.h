@@ -0,0 +1,80 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Storage for search nodes: {state, parent index} records bump-allocated
+// into fixed-size chunks. Records never move, a parent is a 32-bit index
+// rather than a pointer, and the whole search tree is released at once by
+// clear(), which keeps the chunks for the next search.
+template <typename State>
+class NodeArena {
+public:
+    struct Node {
+        State state;
+        uint32_t parent;
+    };
+
+    static constexpr uint32_t none = UINT32_MAX;
+
+    NodeArena() = default;
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+    ~NodeArena() {
+        clear();
+        for (auto chunk : chunks_) allocator().deallocate(chunk, chunk_size);
+    }
+
+    // Adds a node and returns its index. Indices are 32 bits, so a search
+    // can hold up to none - 1 nodes.
+    uint32_t push(const State& state, uint32_t parent = none) {
+        if (size_ == none) throw std::length_error("too many search nodes");
+        const auto chunk = size_ >> chunk_bits;
+        if (chunk == chunks_.size()) chunks_.push_back(allocator().allocate(chunk_size));
+        ::new (static_cast<void*>(chunks_[chunk] + (size_ & chunk_mask))) Node{state, parent};
+        return size_++;
+    }
+
+    const Node& operator[](uint32_t i) const {
+        assert(i < size_);
+        return chunks_[i >> chunk_bits][i & chunk_mask];
+    }
+
+    uint32_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Drops every node; the chunks stay allocated for reuse.
+    void clear() {
+        if constexpr (!std::is_trivially_destructible_v<Node>) {
+            for (uint32_t i = 0; i < size_; ++i) chunks_[i >> chunk_bits][i & chunk_mask].~Node();
+        }
+        size_ = 0;
+    }
+
+private:
+    static constexpr uint32_t chunk_bits = 12;
+    static constexpr uint32_t chunk_size = uint32_t{1} << chunk_bits;
+    static constexpr uint32_t chunk_mask = chunk_size - 1;
+
+    std::vector<Node*> chunks_;
+    uint32_t size_ = 0;
+
+    static std::allocator<Node> allocator() { return {}; }
+};
+
+// States from the root down to node i.
+template <typename State>
+std::vector<State> build_path(const NodeArena<State>& nodes, uint32_t i) {
+    std::vector<State> path;
+    for (; i != NodeArena<State>::none; i = nodes[i].parent) path.push_back(nodes[i].state);
+    return {path.rbegin(), path.rend()};
+}
+
+#endif